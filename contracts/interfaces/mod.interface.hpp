@@ -27,6 +27,9 @@ class [[eosio::contract("mod")]] mod : public contract {
     [[eosio::on_notify(TOTEMS_TRANSFER_NOTIFY)]]
     void on_transfer(const name& from, const name& to, const asset& quantity, const string& memo);
 
+    [[eosio::on_notify(TOTEMS_TRANSFERMANY_NOTIFY)]]
+    void on_transfermany(const std::vector<totems::TransferLeg>& legs);
+
     [[eosio::on_notify(TOTEMS_OPEN_NOTIFY)]]
     void on_open(const name& owner, const symbol& ticker, const name& ram_payer);
 
@@ -0,0 +1,168 @@
+#pragma once
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace eosio;
+
+/***
+ * Rules are small programs that mods which only accept or reject operations can publish instead of
+ * listening for notifications. The totems contract runs them inline on every hooked action.
+ *
+ * A program is straight-line bytecode for a stack machine of int64 values (there are no jumps),
+ * so the cost of running it is bounded by its size. The operation is accepted if the program
+ * leaves a non-zero value on the stack.
+ *
+ * Example: reject transfers of more than 100.0000 tokens
+ *   FIELD AMOUNT, PUSH 1000000, LE  ->  02 02 01 40 42 0f 00 00 00 00 00 23
+ */
+namespace rules {
+
+	// Programs are validated against these limits when they are published
+	static constexpr size_t MAX_PROGRAM_SIZE = 256;
+	static constexpr size_t MAX_STACK_DEPTH = 16;
+
+	enum class Op : uint8_t {
+	    // Followed by an int64 (little endian) to push
+	    PUSH = 0x01,
+	    // Followed by a `Field` to push
+	    FIELD = 0x02,
+
+	    ADD = 0x10,
+	    SUB = 0x11,
+	    MUL = 0x12,
+	    DIV = 0x13,
+
+	    EQ = 0x20,
+	    NE = 0x21,
+	    LT = 0x22,
+	    LE = 0x23,
+	    GT = 0x24,
+	    GE = 0x25,
+
+	    AND = 0x30,
+	    OR = 0x31,
+	    NOT = 0x32
+	};
+
+	// Values a program can read from the operation, accounts are pushed as their raw name value
+	enum class Field : uint8_t {
+	    FROM = 0,
+	    TO = 1,
+	    AMOUNT = 2,
+	    // Balances are read when the hook runs, after transfers and burns moved them (mints are paid out later)
+	    FROM_BALANCE = 3,
+	    TO_BALANCE = 4,
+	    SUPPLY = 5,
+	    MAX_SUPPLY = 6,
+	    // Seconds since epoch
+	    NOW = 7
+	};
+
+	static constexpr uint8_t FIELD_COUNT = 8;
+
+	// The operation a rule is run on.
+	// `from` is the sender, minter mod or burner, and `to` is the receiver or minter (empty for burns).
+	struct Operation {
+	    name from;
+	    name to;
+	    asset quantity;
+	    asset supply;
+	    asset max_supply;
+	    // Not readable by rules, only used to match subscription filters
+	    std::string memo;
+	};
+
+	/***
+	  * Checks that a program is well formed and within the limits, reverts if it isn't
+	  * @param program - The rule bytecode
+	  */
+	inline void validate(const std::vector<uint8_t>& program) {
+	    check(!program.empty(), "Rule program is empty");
+	    check(program.size() <= MAX_PROGRAM_SIZE, "Rule program too large");
+
+	    size_t depth = 0;
+	    for (size_t pc = 0; pc < program.size();) {
+	        switch (static_cast<Op>(program[pc++])) {
+	            case Op::PUSH:
+	                check(pc + sizeof(int64_t) <= program.size(), "Rule program truncated");
+	                pc += sizeof(int64_t);
+	                depth++;
+	                break;
+	            case Op::FIELD:
+	                check(pc < program.size(), "Rule program truncated");
+	                check(program[pc] < FIELD_COUNT, "Unknown rule field");
+	                pc++;
+	                depth++;
+	                break;
+	            case Op::NOT:
+	                check(depth >= 1, "Rule stack underflow");
+	                break;
+	            case Op::ADD: case Op::SUB: case Op::MUL: case Op::DIV:
+	            case Op::EQ: case Op::NE: case Op::LT: case Op::LE: case Op::GT: case Op::GE:
+	            case Op::AND: case Op::OR:
+	                check(depth >= 2, "Rule stack underflow");
+	                depth--;
+	                break;
+	            default:
+	                check(false, "Unknown rule op");
+	        }
+	        check(depth <= MAX_STACK_DEPTH, "Rule stack overflow");
+	    }
+	    check(depth == 1, "Rule program must leave exactly one value");
+	}
+
+	/***
+	  * Runs a validated program
+	  * @param program - The rule bytecode
+	  * @param field - Called with a `Field` to get its value, only for the fields the program reads
+	  * @return true if the operation is accepted
+	  */
+	template <typename FieldReader>
+	bool run(const std::vector<uint8_t>& program, FieldReader&& field) {
+	    int64_t stack[MAX_STACK_DEPTH];
+	    size_t depth = 0;
+
+	    for (size_t pc = 0; pc < program.size();) {
+	        const auto op = static_cast<Op>(program[pc++]);
+	        if (op == Op::PUSH) {
+	            std::memcpy(&stack[depth++], program.data() + pc, sizeof(int64_t));
+	            pc += sizeof(int64_t);
+	            continue;
+	        }
+	        if (op == Op::FIELD) {
+	            stack[depth++] = field(static_cast<Field>(program[pc++]));
+	            continue;
+	        }
+	        if (op == Op::NOT) {
+	            stack[depth - 1] = stack[depth - 1] == 0;
+	            continue;
+	        }
+
+	        const int64_t b = stack[--depth];
+	        int64_t& a = stack[depth - 1];
+	        switch (op) {
+	            case Op::ADD: check(!__builtin_add_overflow(a, b, &a), "Rule overflow"); break;
+	            case Op::SUB: check(!__builtin_sub_overflow(a, b, &a), "Rule overflow"); break;
+	            case Op::MUL: check(!__builtin_mul_overflow(a, b, &a), "Rule overflow"); break;
+	            case Op::DIV:
+	                check(b != 0, "Rule division by zero");
+	                check(!(a == INT64_MIN && b == -1), "Rule overflow");
+	                a /= b;
+	                break;
+	            case Op::EQ: a = a == b; break;
+	            case Op::NE: a = a != b; break;
+	            case Op::LT: a = a < b; break;
+	            case Op::LE: a = a <= b; break;
+	            case Op::GT: a = a > b; break;
+	            case Op::GE: a = a >= b; break;
+	            case Op::AND: a = a != 0 && b != 0; break;
+	            case Op::OR: a = a != 0 || b != 0; break;
+	            default: check(false, "Unknown rule op");
+	        }
+	    }
+	    return stack[0] != 0;
+	}
+}
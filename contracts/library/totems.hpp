@@ -2,8 +2,11 @@
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/crypto.hpp>
+#include <eosio/binary_extension.hpp>
 #include <string>
 #include <vector>
+#include <optional>
+#include <algorithm>
 using namespace eosio;
 
 /*
@@ -31,6 +34,12 @@ using namespace eosio;
 #define TOTEMS_OPEN_NOTIFY "totemstotems::open"
 #define TOTEMS_CLOSE_NOTIFY "totemstotems::close"
 #define TOTEMS_CREATED_NOTIFY "totemstotems::created"
+// Mods on the transfer hook receive this for batched transfers instead of one transfer per leg (see `TransferLeg`).
+// They have to publish the `transfermany` hook along with `transfer` to show they handle it, otherwise
+// their totems can't be transferred in batches.
+#define TOTEMS_TRANSFERMANY_NOTIFY "totemstotems::transfermany"
+// Mods that subscribed in async mode receive their queued events in batches with this (see `HookEvent`)
+#define TOTEMS_DELIVER_NOTIFY "totemstotems::deliver"
 
 
 namespace totems {
@@ -40,6 +49,61 @@ namespace totems {
 	static const name TOTEMS_CONTRACT = "totemstotems"_n;
 	static const name PROXY_MOD_CONTRACT = "totemodproxy"_n;
 
+	/* ---------------- HOOKS ---------------- */
+
+	// Every hook that mods can register for. The value is the hook's bit in a hook mask.
+	enum class Hook : uint8_t {
+	    CREATED = 0,
+	    MINT = 1,
+	    BURN = 2,
+	    TRANSFER = 3,
+	    OPEN = 4,
+	    CLOSE = 5
+	};
+
+	static constexpr uint8_t HOOK_COUNT = 6;
+	static constexpr Hook ALL_HOOKS[HOOK_COUNT] = {
+	    Hook::CREATED, Hook::MINT, Hook::BURN, Hook::TRANSFER, Hook::OPEN, Hook::CLOSE
+	};
+	// Indexed by `Hook`
+	static constexpr name HOOK_NAMES[HOOK_COUNT] = {
+	    "created"_n, "mint"_n, "burn"_n, "transfer"_n, "open"_n, "close"_n
+	};
+
+	constexpr name hook_name(const Hook& hook) {
+	    return HOOK_NAMES[static_cast<uint8_t>(hook)];
+	}
+
+	constexpr uint8_t hook_bit(const Hook& hook) {
+	    return 1 << static_cast<uint8_t>(hook);
+	}
+
+	// Finds the hook for a name, or nullopt if it isn't a hook
+	constexpr std::optional<Hook> find_hook(const name& hook_name) {
+	    for (const auto& hook : ALL_HOOKS) {
+	        if (HOOK_NAMES[static_cast<uint8_t>(hook)] == hook_name) return hook;
+	    }
+	    return std::nullopt;
+	}
+
+	// The bit for a hook inside of a hook mask, or 0 for unknown hooks
+	constexpr uint8_t hook_bit(const name& hook_name) {
+	    auto hook = find_hook(hook_name);
+	    return hook.has_value() ? hook_bit(hook.value()) : 0;
+	}
+
+	// Not a hook of its own: transfer mods publish it to opt into batched `transfermany` notifications.
+	// It's kept in the hook mask of the mod index after the real hooks.
+	static constexpr name TRANSFERMANY_HOOK = "transfermany"_n;
+	static constexpr uint8_t TRANSFERMANY_BIT = 1 << HOOK_COUNT;
+
+	// The hook mask of a set of hook names, including `TRANSFERMANY_BIT`
+	uint8_t hook_mask(const std::set<name>& hooks) {
+	    uint8_t mask = 0;
+	    for (const auto& hook : hooks) mask |= hook == TRANSFERMANY_HOOK ? TRANSFERMANY_BIT : hook_bit(hook);
+	    return mask;
+	}
+
 	/* ---------------- MOD MARKET ---------------- */
 
 	// Defines the type of param in required_actions
@@ -124,9 +188,21 @@ namespace totems {
 	    std::vector<RequiredHook> required_actions;
 	    time_point_sec published_at;
 	    time_point_sec updated_at;
+	    // Rule program that the totems contract runs inline instead of notifying the mod (see rules.hpp)
+	    binary_extension<std::vector<uint8_t>> rule;
+	    // `hooks` as a hook mask (see `hook_mask`), mods published before it existed only have `hooks`
+	    binary_extension<uint8_t> hooks_mask;
+
+	    bool has_hook(const Hook& hook) const {
+	        if (hooks_mask.has_value()) return (hooks_mask.value() & hook_bit(hook)) != 0;
+	        return hooks.find(hook_name(hook)) != hooks.end();
+	    }
 
 	    bool has_hook(const name& hook_name) const {
-	        return std::find(hooks.begin(), hooks.end(), hook_name) != hooks.end();
+	        if (hooks_mask.has_value()) {
+	            return (hooks_mask.value() & (hook_name == TRANSFERMANY_HOOK ? TRANSFERMANY_BIT : hook_bit(hook_name))) != 0;
+	        }
+	        return hooks.find(hook_name) != hooks.end();
 	    }
 
 	    uint64_t primary_key() const { return contract.value; }
@@ -144,6 +220,71 @@ namespace totems {
 	    return *mod;
 	}
 
+	// Digest of a mod's required actions, so you can tell if a mod has any (or if they changed) without reading them
+	checksum256 required_actions_digest(const std::vector<RequiredHook>& required_actions) {
+	    auto packed = eosio::pack(required_actions);
+	    return eosio::sha256(packed.data(), packed.size());
+	}
+
+	// A small fixed-size summary of a Mod that the market keeps next to every published mod.
+	// Use this when you only need to check prices, sellers, hooks or minters
+	// so you don't have to read the mod's markdown and required actions.
+	struct [[eosio::table]] ModIndex {
+	    name contract;
+	    name seller;
+	    uint64_t price;
+	    // One bit per supported hook (see `hook_bit`)
+	    uint8_t hooks;
+	    bool is_minter;
+	    checksum256 required_actions_digest;
+	    // Whether the mod is a rule program instead of a notified contract
+	    bool has_rule;
+
+	    bool has_hook(const Hook& hook) const {
+	        return (hooks & hook_bit(hook)) != 0;
+	    }
+
+	    bool has_hook(const name& hook_name) const {
+	        return (hooks & hook_bit(hook_name)) != 0;
+	    }
+
+	    bool handles_transfermany() const {
+	        return (hooks & TRANSFERMANY_BIT) != 0;
+	    }
+
+	    uint64_t primary_key() const { return contract.value; }
+	};
+
+	typedef eosio::multi_index<"modindex"_n, ModIndex> mod_index_table;
+
+	ModIndex make_mod_index(const Mod& mod) {
+	    return ModIndex{
+	        .contract = mod.contract,
+	        .seller = mod.seller,
+	        .price = mod.price,
+	        .hooks = mod.hooks_mask.has_value() ? mod.hooks_mask.value() : hook_mask(mod.hooks),
+	        .is_minter = mod.details.is_minter,
+	        .required_actions_digest = required_actions_digest(mod.required_actions),
+	        .has_rule = mod.rule.has_value() && !mod.rule.value().empty()
+	    };
+	}
+
+	// Fetches the index row of a mod from the market, or nullopt if the mod doesn't exist.
+	// Mods published before the index existed fall back to the full mod row.
+	std::optional<ModIndex> get_mod_index(const name& contract) {
+	    mod_index_table index(MARKET_CONTRACT, MARKET_CONTRACT.value);
+	    auto it = index.find(contract.value);
+	    if (it != index.end()) {
+	        return *it;
+	    }
+
+	    auto mod = get_mod(contract);
+	    if (!mod.has_value()) {
+	        return std::nullopt;
+	    }
+	    return make_mod_index(mod.value());
+	}
+
 	/* ---------------- TOTEMS ---------------- */
 	// Balance table for each account
 	struct [[eosio::table]] Balance {
@@ -154,6 +295,20 @@ namespace totems {
 
 	typedef eosio::multi_index<"accounts"_n, Balance> balances_table;
 
+	// Every account with a balance of a totem, scoped by ticker.
+	// Balances are scoped by owner, so this is what lets you list (or rank) the holders of a totem.
+	struct [[eosio::table]] Holder {
+	    name owner;
+	    uint64_t amount;
+
+	    uint64_t primary_key() const { return owner.value; }
+	    uint64_t by_balance() const { return amount; }
+	};
+
+	typedef eosio::multi_index<"holders"_n, Holder,
+	    indexed_by<"bybalance"_n, const_mem_fun<Holder, uint64_t, &Holder::by_balance>>
+	> holders_table;
+
 	// Allocations are initial supply distributions when a totem is created
 	// The quantity here will never be reduced so that there will always be a
 	// record of who was allocated what at creation time.
@@ -183,23 +338,196 @@ namespace totems {
 		std::vector<name> open;
 		std::vector<name> close;
 		std::vector<name> created;
+
+		// The mods registered for a hook
+		const std::vector<name>& operator[](const Hook& hook) const {
+		    static constexpr std::vector<name> TotemMods::* FIELDS[HOOK_COUNT] = {
+		        &TotemMods::created, &TotemMods::mint, &TotemMods::burn,
+		        &TotemMods::transfer, &TotemMods::open, &TotemMods::close
+		    };
+		    return this->*FIELDS[static_cast<uint8_t>(hook)];
+		}
+	};
+
+	// A single transfer inside of a `transfermany` batch
+	struct TransferLeg {
+	    name from;
+	    name to;
+	    asset quantity;
+	    std::string memo;
+	};
+
+	// Policies that the totems contract enforces itself, so they don't need a mod (and a notification) to run
+	struct TotemPolicy {
+	    // Frozen totems can't be transferred, minted or burned
+	    bool frozen;
+	    // The most an account can hold after receiving totems, in basis points of max_supply (0 for no cap)
+	    uint16_t max_holding_bps;
+	    // The hooks whose actions are paused, as `hook_bit`s
+	    uint8_t paused_hooks;
+
+	    bool is_paused(const Hook& hook) const {
+	        return (paused_hooks & hook_bit(hook)) != 0;
+	    }
 	};
 
 	// Totems that have been created
+	// This only holds what hooked actions need (supply, precision, creator, mods) so that
+	// transfers and burns don't (de)serialize allocations and details every time.
+	// BREAKING: this used to be the `totems` table, with `allocations`, `details` and the timestamps in it
+	// (they are in `totemmeta` now). Mods built against the old library read the legacy `totems` table,
+	// which only has the totems created before the split and is dropped after migration, so they have to
+	// be rebuilt with this library.
 	struct [[eosio::table]] Totem {
 	    name creator;
 	    asset supply;
 	    asset max_supply;
-	    std::vector<MintAllocation> allocations;
 	    TotemMods mods;
+	    // Only set once the creator sets a policy with `setpolicy`
+	    binary_extension<TotemPolicy> policy;
+
+	    uint64_t primary_key() const { return max_supply.symbol.code().raw(); }
+	    // (creator << 64 | ticker) so that a creator's totems are one contiguous range
+	    uint128_t by_creator() const {
+	        return (static_cast<uint128_t>(creator.value) << 64) | max_supply.symbol.code().raw();
+	    }
+	};
+
+	typedef eosio::multi_index<"totemcore"_n, Totem,
+	    indexed_by<"bycreator"_n, const_mem_fun<Totem, uint128_t, &Totem::by_creator>>
+	> totems_table;
+
+	// Descriptive data for a totem, only written on creation
+	struct [[eosio::table]] TotemMeta {
+	    symbol ticker;
+	    std::vector<MintAllocation> allocations;
+	    // The number of allocations the totem was created with. Totems created in chunks (`finalize`)
+	    // don't copy their allocations here, for them `allocations` is empty and only this is set.
+	    uint32_t allocation_count;
 	    TotemDetails details;
 	    time_point_sec created_at;
 	    time_point_sec updated_at;
 
-	    uint64_t primary_key() const { return max_supply.symbol.code().raw(); }
+	    uint64_t primary_key() const { return ticker.code().raw(); }
+	    // (created_at << 64 | ticker) so that totems created in the same second still have unique keys
+	    uint128_t by_created() const {
+	        return (static_cast<uint128_t>(created_at.sec_since_epoch()) << 64) | ticker.code().raw();
+	    }
+	};
+
+	typedef eosio::multi_index<"totemmeta"_n, TotemMeta,
+	    indexed_by<"bycreated"_n, const_mem_fun<TotemMeta, uint128_t, &TotemMeta::by_created>>
+	> totem_meta_table;
+
+	// Totems that are being created in chunks (`reserve`, then `allocate` batches, then `finalize`).
+	// The ticker is taken while this row exists, but the totem can't be used until it is finalized.
+	struct [[eosio::table]] PendingTotem {
+	    symbol ticker;
+	    name creator;
+	    TotemMods mods;
+	    TotemDetails details;
+	    // Running totals of the allocations written so far
+	    asset supply;
+	    uint32_t allocations;
+	    uint64_t mints;
+	    uint64_t holders;
+
+	    uint64_t primary_key() const { return ticker.code().raw(); }
+	};
+
+	typedef eosio::multi_index<"pendings"_n, PendingTotem> pending_totems_table;
+
+	// A Merkle root of allocations that are only written when their recipients claim them (see `claimalloc`).
+	// Leaves are `allocation_leaf(index, account, quantity)`, and each pair is hashed in sorted order.
+	struct AllocationRoot {
+	    checksum256 root;
+	    // The sum of the quantities of all leaves
+	    asset total;
+	    // The number of leaves, leaf indices go from 0 to leaves - 1
+	    uint32_t leaves;
+	};
+
+	// The allocation root of a totem and how much of it has been claimed
+	struct [[eosio::table]] AllocationDrop {
+	    symbol ticker;
+	    AllocationRoot allocations;
+	    asset claimed;
+	    uint32_t claims;
+
+	    uint64_t primary_key() const { return ticker.code().raw(); }
+	};
+
+	typedef eosio::multi_index<"drops"_n, AllocationDrop> drops_table;
+
+	// Bitmap of the claimed leaves of a drop, 64 leaves per row. Scoped by ticker.
+	struct [[eosio::table]] DropClaims {
+	    uint64_t word;
+	    uint64_t bits;
+
+	    uint64_t primary_key() const { return word; }
+	};
+
+	typedef eosio::multi_index<"dropclaims"_n, DropClaims> drop_claims_table;
+
+	/***
+	  * The Merkle leaf of a lazy allocation
+	  * @param index - The leaf index
+	  * @param account - The recipient of the allocation
+	  * @param quantity - The allocated quantity
+	  * @return sha256 of the packed (index, account, quantity)
+	  */
+	checksum256 allocation_leaf(const uint32_t& index, const name& account, const asset& quantity) {
+	    auto packed = eosio::pack(std::make_tuple(index, account, quantity));
+	    return eosio::sha256(packed.data(), packed.size());
+	}
+
+	/***
+	  * Checks a Merkle proof where every pair is hashed in sorted order (smallest hash first)
+	  * @param leaf - The leaf to prove
+	  * @param proof - The sibling hashes from the leaf up to the root
+	  * @param root - The expected root
+	  * @return true if the proof leads to the root
+	  */
+	bool verify_merkle_proof(const checksum256& leaf, const std::vector<checksum256>& proof, const checksum256& root) {
+	    checksum256 node = leaf;
+	    for (const auto& sibling : proof) {
+	        auto a = node.extract_as_byte_array();
+	        auto b = sibling.extract_as_byte_array();
+	        if (b < a) std::swap(a, b);
+
+	        std::array<uint8_t, 64> pair;
+	        std::copy(a.begin(), a.end(), pair.begin());
+	        std::copy(b.begin(), b.end(), pair.begin() + 32);
+	        node = eosio::sha256(reinterpret_cast<const char*>(pair.data()), pair.size());
+	    }
+	    return node == root;
+	}
+
+	// Mods that can mint a totem, scoped by ticker.
+	// Written on creation from the minter allocations, so that `mint` is one keyed lookup.
+	struct [[eosio::table]] Minter {
+	    name mod;
+
+	    uint64_t primary_key() const { return mod.value; }
+	};
+
+	typedef eosio::multi_index<"minters"_n, Minter> minters_table;
+
+	// Written by `mint` right before it calls the minter mod, and used up by `mintpay`.
+	// A ticket that wasn't used is erased by `endmint` at the end of the same mint, so it never outlives it.
+	// Scoped by ticker.
+	struct [[eosio::table]] MintTicket {
+	    name mod;
+	    name minter;
+	    // The quantity that was requested, the payout has to match it
+	    asset quantity;
+	    // The transaction that minted, the payout has to be part of it
+	    checksum256 transaction_id;
+
+	    uint64_t primary_key() const { return mod.value; }
 	};
 
-	typedef eosio::multi_index<"totems"_n, Totem> totems_table;
+	typedef eosio::multi_index<"minttickets"_n, MintTicket> mint_tickets_table;
 
 	// Totem statistics for tracking mints, burns, transfers, holders
 	// This is an experiment to do this on-chain instead of offchain.
@@ -212,10 +540,21 @@ namespace totems {
 		uint64_t transfers;
 		uint64_t holders;
 		uint64_t primary_key() const { return ticker.code().raw(); }
+
+		// Ranking keys are (metric << 64 | ticker) so that they're unique per totem and can be used as cursors
+		uint128_t rank_key(const uint64_t& metric) const {
+		    return (static_cast<uint128_t>(metric) << 64) | ticker.code().raw();
+		}
+		uint128_t by_holders() const { return rank_key(holders); }
+		uint128_t by_transfers() const { return rank_key(transfers); }
+		uint128_t by_mints() const { return rank_key(mints); }
 	};
 
-	// TODO: Maybe add some indices here for sorting by mints, burns, holders, etc?
-	typedef eosio::multi_index<"totemstats"_n, TotemStats> totemstats_table;
+	typedef eosio::multi_index<"totemstats"_n, TotemStats,
+	    indexed_by<"byholders"_n, const_mem_fun<TotemStats, uint128_t, &TotemStats::by_holders>>,
+	    indexed_by<"bytransfers"_n, const_mem_fun<TotemStats, uint128_t, &TotemStats::by_transfers>>,
+	    indexed_by<"bymints"_n, const_mem_fun<TotemStats, uint128_t, &TotemStats::by_mints>>
+	> totemstats_table;
 
 	/***
 	  * Fetches a totem by its ticker symbol code
@@ -231,6 +570,20 @@ namespace totems {
 	    return *totem;
 	}
 
+	/***
+	  * Fetches the descriptive data (allocations, details, timestamps) of a totem by its ticker symbol code
+	  * @param code - The symbol code of the totem/ticker
+	  * @return An optional TotemMeta struct, nullopt if it doesn't exist
+	  */
+	std::optional<TotemMeta> get_totem_meta(const symbol_code& code) {
+	    totem_meta_table metas(TOTEMS_CONTRACT, TOTEMS_CONTRACT.value);
+	    auto meta = metas.find(code.raw());
+	    if (meta == metas.end()) {
+	        return std::nullopt;
+	    }
+	    return *meta;
+	}
+
 	/***
 	  * Fetches the creator of a totem by its ticker symbol code
 	  * @param code - The symbol code of the totem/ticker
@@ -274,20 +627,66 @@ namespace totems {
 	    ).send();
 	}
 
+	// Every mod licensed for a totem, in one row per ticker.
+	// `mods` is kept sorted so that checking a license is a binary search.
+	struct [[eosio::table]] LicenseSet {
+	    symbol_code ticker;
+	    std::vector<name> mods;
+
+	    bool has(const name& mod) const {
+	        return std::binary_search(mods.begin(), mods.end(), mod);
+	    }
+
+	    uint64_t primary_key() const { return ticker.raw(); }
+	};
+
+	// scoped to the totems contract
+	typedef eosio::multi_index<"licenseset"_n, LicenseSet> license_set_table;
+
+	// One row per licensed mod, the layout from before `licenseset`.
+	// The proxy mod contract still keeps its licenses like this, the totems contract only has them
+	// for totems that `migratelics` hasn't moved into `licenseset` yet.
 	struct [[eosio::table]] License {
-        name mod;
-        uint64_t primary_key() const { return mod.value; }
-    };
+	    name mod;
+	    uint64_t primary_key() const { return mod.value; }
+	};
 
 	// scoped to ticker (symbol_code)
-    typedef eosio::multi_index<"licenses"_n, License> license_table;
+	typedef eosio::multi_index<"licenses"_n, License> license_table;
+
+	// The totems that use a mod, scoped to the mod
+	struct [[eosio::table]] ModUsage {
+	    symbol_code ticker;
+	    // The hooks the totem uses the mod on (see `hook_bit`)
+	    uint8_t hooks;
+
+	    uint64_t primary_key() const { return ticker.raw(); }
+	};
+
+	typedef eosio::multi_index<"modusage"_n, ModUsage> mod_usage_table;
+
+	// How many totems use each mod, scoped to the totems contract
+	struct [[eosio::table]] ModUsageCount {
+	    name mod;
+	    uint64_t totems;
+
+	    uint64_t primary_key() const { return mod.value; }
+	    // (totems << 64 | mod) so that keys are unique and can be used as cursors
+	    uint128_t by_usage() const { return (static_cast<uint128_t>(totems) << 64) | mod.value; }
+	};
+
+	typedef eosio::multi_index<"modcounts"_n, ModUsageCount,
+	    indexed_by<"byusage"_n, const_mem_fun<ModUsageCount, uint128_t, &ModUsageCount::by_usage>>
+	> mod_counts_table;
 
 	void check_license(const symbol_code& ticker, const name& mod){
 		{
-			license_table licenses(TOTEMS_CONTRACT, ticker.raw());
-			if(licenses.find(mod.value) != licenses.end()) return;
+			license_set_table licenses(TOTEMS_CONTRACT, TOTEMS_CONTRACT.value);
+			auto it = licenses.find(ticker.raw());
+			if(it != licenses.end() && it->has(mod)) return;
 		}
 		{
+			// the proxy only has per-ticker license rows
 			if(is_account(PROXY_MOD_CONTRACT)){
 				license_table licenses(PROXY_MOD_CONTRACT, ticker.raw());
 				if(licenses.find(mod.value) != licenses.end()) return;
@@ -321,6 +720,194 @@ namespace totems {
 	    return required_actions;
 	}
 
+	// A required action field stripped down to what the verifier actually compares.
+	// DYNAMIC fields are never compared, so they don't make it into a plan at all.
+	struct PlanField {
+	    uint8_t type;
+	    uint16_t offset;
+	    uint16_t size;
+	    std::vector<char> data;
+	};
+
+	struct PlanAction {
+	    name contract;
+	    name action;
+	    std::vector<PlanField> fields;
+	};
+
+	// A rule mod's program, compiled into the hook plans of the totems that use it
+	struct ModRule {
+	    name mod;
+	    std::vector<uint8_t> program;
+	};
+
+	// The required actions of every mod on a single hook of a totem, one entry per requirement.
+	// These are compiled once when the totem is created so that hooked actions only need a
+	// single keyed read instead of re-resolving every mod from the market.
+	// Plans are a snapshot: if the market data of a mod changes, the plans of the totems using it
+	// stay as they were until `compileplans` is called for them.
+	// A hook with no required actions and no rules has no plan row.
+	struct [[eosio::table]] HookPlan {
+	    name hook;
+	    std::vector<PlanAction> actions;
+	    // The rule programs of the rule mods on this hook, run on every hooked action
+	    binary_extension<std::vector<ModRule>> rules;
+
+	    uint64_t primary_key() const { return hook.value; }
+	};
+
+	// scoped to ticker (symbol_code)
+	typedef eosio::multi_index<"hookplans"_n, HookPlan> hookplans_table;
+
+	// Which side of an operation the accounts of a `HookFilter` are matched on
+	enum FilterDirection : uint8_t {
+	    FILTER_ANY = 0,
+	    FILTER_FROM = 1,
+	    FILTER_TO = 2
+	};
+
+	static constexpr size_t MAX_FILTER_ACCOUNTS = 8;
+	static constexpr size_t MAX_FILTER_MEMO_PREFIX = 32;
+
+	// A mod's subscription filter for one hook of a totem.
+	// The mod is only notified of operations that match every filter that is set.
+	struct HookFilter {
+	    name mod;
+	    // Operations touching one of these accounts (empty for any account)
+	    std::vector<name> accounts;
+	    uint8_t direction;
+	    int64_t min_amount;
+	    // Memos starting with this prefix (empty for any memo)
+	    std::string memo_prefix;
+	    // Queue matching operations for `crank` instead of notifying the mod inside of them
+	    bool async;
+
+	    bool matches(const name& from, const name& to, const int64_t& amount, const std::string& memo) const {
+	        if (amount < min_amount) return false;
+	        if (!memo_prefix.empty() && memo.compare(0, memo_prefix.size(), memo_prefix) != 0) return false;
+	        if (accounts.empty()) return true;
+
+	        for (const auto& account : accounts) {
+	            if (direction != FILTER_TO && account == from) return true;
+	            if (direction != FILTER_FROM && account == to) return true;
+	        }
+	        return false;
+	    }
+	};
+
+	// The subscription filters of every mod on one hook of a totem, so `notify_mods` reads a single row.
+	// Mods without a filter are always notified.
+	struct [[eosio::table]] HookSubscriptions {
+	    name hook;
+	    std::vector<HookFilter> filters;
+
+	    uint64_t primary_key() const { return hook.value; }
+	};
+
+	// scoped to ticker (symbol_code)
+	typedef eosio::multi_index<"hooksubs"_n, HookSubscriptions> hook_subscriptions_table;
+
+	// The most events that can wait in a mod's queue, mods are notified synchronously while their queue is full.
+	// A mod that can't process an event at the head of its queue can drop it with `skipevents`.
+	static constexpr uint64_t MAX_QUEUED_EVENTS = 1000;
+
+	// Queued memos are cut to this many bytes, the contract pays for the queue rows
+	static constexpr size_t MAX_QUEUED_MEMO = 256;
+
+	// An operation queued for an async mod, scoped by mod
+	struct [[eosio::table]] HookEvent {
+	    uint64_t id;
+	    name hook;
+	    name from;
+	    name to;
+	    asset quantity;
+	    // The first `MAX_QUEUED_MEMO` bytes of the memo
+	    std::string memo;
+
+	    uint64_t primary_key() const { return id; }
+	};
+
+	typedef eosio::multi_index<"hookqueue"_n, HookEvent> hook_queue_table;
+
+	// The position of a mod's queue, events `head` to `next_id - 1` are waiting to be delivered
+	struct [[eosio::table]] AsyncQueue {
+	    name mod;
+	    uint64_t next_id;
+	    uint64_t head;
+
+	    uint64_t primary_key() const { return mod.value; }
+	};
+
+	typedef eosio::multi_index<"asyncqueues"_n, AsyncQueue> async_queues_table;
+
+	// The number of slots in the event journal, older events are overwritten by newer ones
+	static constexpr uint64_t JOURNAL_SIZE = 10000;
+
+	// A fixed-layout record of something that happened to a totem, so indexers can follow totems without parsing traces.
+	// Kinds: create, allocate, claim, mint, mintpay, burn, transfer, open, close
+	// (mint is the request, its balance moves with mintpay)
+	struct [[eosio::table]] JournalEvent {
+	    // Global sequence number, starting at 1
+	    uint64_t seq;
+	    // Sequence number within the totem, starting at 1
+	    uint64_t ticker_seq;
+	    name kind;
+	    symbol_code ticker;
+	    name from;
+	    name to;
+	    int64_t amount;
+	    time_point_sec time;
+
+	    // The journal is a ring buffer, so rows are keyed by their slot
+	    uint64_t primary_key() const { return seq % JOURNAL_SIZE; }
+	};
+
+	typedef eosio::multi_index<"journal"_n, JournalEvent> journal_table;
+
+	// The last global sequence number of the journal
+	struct [[eosio::table]] JournalState {
+	    uint64_t last_seq;
+	};
+
+	// The last sequence number of a totem in the journal
+	struct [[eosio::table]] TickerSeq {
+	    symbol_code ticker;
+	    uint64_t last_seq;
+
+	    uint64_t primary_key() const { return ticker.raw(); }
+	};
+
+	typedef eosio::multi_index<"tickerseqs"_n, TickerSeq> ticker_seqs_table;
+
+	/***
+	  * Appends the required actions a mod has for a hook to a plan.
+	  * Every requirement keeps its own entry, even if another mod (or the same one) requires an identical action,
+	  * because each entry has to be matched by a distinct action of the transaction, like it was before plans.
+	  * @param plan - The plan being compiled
+	  * @param mod - The mod to take required actions from
+	  * @param hook - The hook the plan is for
+	  */
+	void merge_into_plan(std::vector<PlanAction>& plan, const Mod& mod, const name& hook) {
+	    for (const auto& req_hook : mod.required_actions) {
+	        if (req_hook.hook != hook) continue;
+
+	        for (const auto& req : req_hook.actions) {
+	            PlanAction compiled{ .contract = req.contract, .action = req.action, .fields = {} };
+	            for (const auto& field : req.fields) {
+	                if (field.type == DYNAMIC) continue;
+	                compiled.fields.push_back(PlanField{
+	                    .type = field.type,
+	                    .offset = field.offset,
+	                    .size = field.size,
+	                    .data = field.data
+	                });
+	            }
+
+	            plan.push_back(std::move(compiled));
+	        }
+	    }
+	}
+
 	// Adds a backwards compatibility table so that wallets and tools
 	// that support `eosio.token` standard can read totem token stats.
 	// Cannot merge these two because the scope is different and you'd need
@@ -3,6 +3,7 @@
 #include <eosio/asset.hpp>
 #include <eosio/transaction.hpp>
 #include <cstring>
+#include <algorithm>
 #include "totems.hpp"
 
 using namespace eosio;
@@ -10,57 +11,112 @@ using namespace eosio;
 namespace action_verifier {
 
 	struct required_entry {
-	    name contract;
-	    name action;
+	    uint64_t key;
 	    uint32_t index;
+
+	    bool operator<(const required_entry& other) const {
+	        return key < other.key || (key == other.key && index < other.index);
+	    }
 	};
 
+	// Packed actions start with `account` and `name`, which is all we need to know if it's a candidate
+	static constexpr size_t ACTION_HEADER_SIZE = sizeof(name) * 2;
+	// actor + permission
+	static constexpr size_t PERMISSION_LEVEL_SIZE = sizeof(name) * 2;
+
+	// Mixes the contract and action into a single key for the sorted lookup index
+	inline uint64_t entry_key(const uint64_t& contract, const uint64_t& action) {
+	    return contract ^ (action * 0x9E3779B97F4A7C15ull);
+	}
+
+	inline const char* read_varuint32(const char* pos, const char* end, uint32_t& value) {
+	    value = 0;
+	    uint8_t shift = 0;
+	    uint8_t byte;
+	    do {
+	        check(pos < end && shift < 35, "Malformed packed action");
+	        byte = static_cast<uint8_t>(*pos++);
+	        value |= uint32_t(byte & 0x7f) << shift;
+	        shift += 7;
+	    } while (byte & 0x80);
+	    return pos;
+	}
+
     /*
      * Verifies that all required actions exist in the current transaction
      * Reverts if any required action is missing or invalid
+     * Works with both `totems::RequiredAction` and compiled `totems::PlanAction` lists
+     *
+     * Transaction actions are read packed into a single reused buffer and only the
+     * account/name header is looked at unless it matches a required (contract, action).
      */
+    template <typename Required>
     void verify(
         const name& sender,
         const symbol_code& ticker,
-        const std::vector<totems::RequiredAction>& required
+        const std::vector<Required>& required
     ) {
+        if (required.empty()) return;
+
         std::vector<bool> validated(required.size(), false);
         uint32_t validated_count = 0;
 
-        // Flatten required actions for faster iteration
+        // Sorted index of required (contract, action) pairs
         std::vector<required_entry> required_entries;
         required_entries.reserve(required.size());
 
         for (uint32_t i = 0; i < required.size(); i++) {
             required_entries.push_back({
-                required[i].contract,
-                required[i].action,
+                entry_key(required[i].contract.value, required[i].action.value),
                 i
             });
         }
+        std::sort(required_entries.begin(), required_entries.end());
 
         // Cache raw bytes once
         const char* sender_bytes = reinterpret_cast<const char*>(&sender);
         const char* ticker_bytes = reinterpret_cast<const char*>(&ticker);
 
-        // Iterate transaction actions exactly once
-        for (uint32_t i = 0; ; i++) {
-            if (validated_count == required.size()) break;
-            action act = get_action(1, i);
+        std::vector<char> buffer(256);
+
+        // Iterate transaction actions exactly once, stopping at the real action count
+        for (uint32_t i = 0; validated_count < required.size(); i++) {
+            int32_t size = internal_use_do_not_use::get_action(1, i, buffer.data(), buffer.size());
+            if (size < 0) break;
+            if (static_cast<size_t>(size) > buffer.size()) {
+                buffer.resize(size);
+                internal_use_do_not_use::get_action(1, i, buffer.data(), buffer.size());
+            }
+            check(static_cast<size_t>(size) >= ACTION_HEADER_SIZE, "Malformed packed action");
+
+            uint64_t account, action_name;
+            std::memcpy(&account, buffer.data(), sizeof(uint64_t));
+            std::memcpy(&action_name, buffer.data() + sizeof(uint64_t), sizeof(uint64_t));
+
+            const uint64_t key = entry_key(account, action_name);
+            auto entry = std::lower_bound(required_entries.begin(), required_entries.end(), required_entry{key, 0});
+
+            for (; entry != required_entries.end() && entry->key == key; ++entry) {
+                if (validated[entry->index]) continue;
 
-            for (const auto& entry : required_entries) {
-                if (validated[entry.index]) continue;
-                if (act.account != entry.contract) continue;
-                if (act.name != entry.action) continue;
+                const auto& req = required[entry->index];
+                if (req.contract.value != account) continue;
+                if (req.action.value != action_name) continue;
 
-                const auto& req  = required[entry.index];
-                const auto& data = act.data;
+                // Skip past the authorization vector to get to the action data
+                const char* end = buffer.data() + size;
+                uint32_t auth_count, data_size;
+                const char* pos = read_varuint32(buffer.data() + ACTION_HEADER_SIZE, end, auth_count);
+                check(static_cast<size_t>(end - pos) >= size_t(auth_count) * PERMISSION_LEVEL_SIZE, "Malformed packed action");
+                pos = read_varuint32(pos + size_t(auth_count) * PERMISSION_LEVEL_SIZE, end, data_size);
+                check(static_cast<size_t>(end - pos) >= data_size, "Malformed packed action");
+                const char* data = pos;
 
                 for (const auto& field : req.fields) {
-                    check(field.offset + field.size <= data.size(),
+                    check(field.offset + field.size <= data_size,
                           "Action data too small");
 
-                    const char* actual = data.data() + field.offset;
+                    const char* actual = data + field.offset;
 
                     switch (field.type) {
 
@@ -111,7 +167,7 @@ namespace action_verifier {
                     }
                 }
 
-                validated[entry.index] = true;
+                validated[entry->index] = true;
                 validated_count++;
                 break;
             }
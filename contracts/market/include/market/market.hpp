@@ -4,6 +4,7 @@
 #include <eosio/eosio.hpp>
 #include <eosio/system.hpp>
 #include "../library/totems.hpp"
+#include "../library/rules.hpp"
 #include "../shared/shared.hpp"
 
 using namespace eosio;
@@ -14,7 +15,10 @@ class [[eosio::contract("market")]] market : public contract {
 
 	// Adds the `mods` table to this contract's ABI
 	typedef eosio::multi_index<"mods"_n, totems::Mod> mods_table;
+	typedef eosio::multi_index<"modindex"_n, totems::ModIndex> mod_index_table;
 	typedef eosio::multi_index<"feeconfig"_n, shared::FeeConfig> fee_config_table;
+	typedef eosio::multi_index<"feeledger"_n, shared::FeeCredit> fee_ledger_table;
+	typedef eosio::multi_index<"feesowed"_n, shared::FeesOwed> fees_owed_table;
 
 	[[eosio::action]]
 	void setfee(const uint64_t& amount){
@@ -26,6 +30,25 @@ class [[eosio::contract("market")]] market : public contract {
 		return shared::get_base_fee(get_self());
 	}
 
+	/***
+	 * Pays out all fees credited to an account
+	 * @param account - The account to pay out
+	 */
+	[[eosio::action]]
+	void claim(const name& account){
+		require_auth(account);
+		shared::claim_fees(get_self(), account);
+	}
+
+	/***
+	 * Pays out credited fees in bulk (anyone can call this, fees only go to their recipients)
+	 * @param max_rows - The maximum number of recipients to pay out
+	 */
+	[[eosio::action]]
+	void sweepfees(const uint32_t& max_rows){
+		shared::sweep_fees(get_self(), max_rows);
+	}
+
 	/***
 	  * Publish a mod to the market
 	  * @param seller - The account publishing the mod (will receive payments)
@@ -35,6 +58,8 @@ class [[eosio::contract("market")]] market : public contract {
 	  * @param details - The mod details struct
 	  * @param required_actions - A vector of third party required actions and their hooks
 	  * @param referrer - Optional referrer account to receive a portion of the publish fee (fee itself doesn't change)
+	  * @param rule - Optional rule program (see rules.hpp) that totems run inline instead of notifying the mod.
+	  *               Rule mods don't need a deployed contract, but the mod account has to authorize publishing.
 	  */
     [[eosio::action]]
     void publish(
@@ -44,7 +69,8 @@ class [[eosio::contract("market")]] market : public contract {
         const uint64_t& price,
         const totems::ModDetails& details,
         const std::vector<totems::RequiredHook>& required_actions,
-        const std::optional<name>& referrer
+        const std::optional<name>& referrer,
+        const binary_extension<std::vector<uint8_t>>& rule
     );
 
 	/***
@@ -56,6 +82,18 @@ class [[eosio::contract("market")]] market : public contract {
     [[eosio::action]]
     void update(const name& contract, const uint64_t& price, const totems::ModDetails& details);
 
+	/***
+	 * Writes the `modindex` row for mods that were published before the index existed
+	 * @param contracts - The mods to (re)index
+	 */
+    [[eosio::action]]
+    void indexmods(const std::vector<name>& contracts);
+
+	/***
+	 * Licenses more mods for an existing totem, paid like mods are on creation (the mod prices go to their sellers)
+	 * @param ticker - The totem ticker, only its creator can add licenses
+	 * @param mods - The published mods to license
+	 */
     [[eosio::action]]
     void addlicenses(const symbol_code& ticker, const std::vector<name>& mods);
 
@@ -68,8 +106,95 @@ class [[eosio::contract("market")]] market : public contract {
     [[eosio::action, eosio::read_only]]
     GetModsResult getmods(const std::vector<name>& contracts);
 
+	// Only what UIs need to show a mod in a list, so listings don't serialize markdown and required actions
+	struct ModCard {
+		name contract;
+		name seller;
+		uint64_t price;
+		std::set<name> hooks;
+		std::string title;
+		std::string image;
+		bool is_minter;
+	};
+
+	struct GetModCardsResult {
+		std::vector<ModCard> cards;
+		name cursor;
+		bool has_more;
+	};
+
+	/***
+	 * Same as `getmods`, but returns cards instead of full mods
+	 * @param contracts - The mods to get cards for
+	 */
+    [[eosio::action, eosio::read_only]]
+    GetModCardsResult modcards(const std::vector<name>& contracts);
+
+	// Filters for `querymods`, every set filter has to match
+	struct ModQuery {
+		std::optional<name> seller;
+		std::optional<name> hook;
+		std::optional<bool> is_minter;
+		std::optional<uint64_t> min_price;
+		std::optional<uint64_t> max_price;
+	};
+
+	/***
+	 * Finds mods matching a query, returned as cards. Filters are evaluated on the `modindex` rows, so mods
+	 * published before the index existed only show up after `indexmods`.
+	 * @param query - The filters to match
+	 * @param per_page - The maximum number of matches to return
+	 * @param cursor - An optional cursor to continue scanning from (the cursor of the previous page)
+	 * @param max_rows - The maximum number of mods to scan in this call (0 for no limit), a page can have no matches but still has_more
+	 * @param max_bytes - The maximum size of the response in bytes (0 for no limit), pages end early when the next row doesn't fit
+	 */
+    [[eosio::action, eosio::read_only]]
+    GetModCardsResult querymods(
+        const ModQuery& query,
+        const uint32_t& per_page,
+        const std::optional<name>& cursor,
+        const uint32_t& max_rows,
+        const uint32_t& max_bytes
+    );
+
+	struct RankedModCard {
+		ModCard card;
+		// The number of totems that use the mod
+		uint64_t totems;
+	};
+
+	struct RankModsResult {
+		std::vector<RankedModCard> cards;
+		uint128_t cursor;
+		bool has_more;
+	};
+
+	/***
+	 * Ranks mods by how many totems use them, most used first
+	 * @param per_page - The number of mods to return per page
+	 * @param cursor - An optional cursor to continue ranking from (the cursor of the previous page)
+	 * @param max_bytes - The maximum size of the response in bytes (0 for no limit), pages end early when the next row doesn't fit
+	 */
+    [[eosio::action, eosio::read_only]]
+    RankModsResult rankmods(const uint32_t& per_page, const std::optional<uint128_t>& cursor, const uint32_t& max_bytes);
+
+	/***
+	 * Same as `listmods`, but returns cards instead of full mods
+	 * @param per_page - The number of mods to return per page
+	 * @param cursor - An optional cursor to continue listing from (the last mod of the previous page)
+	 * @param max_bytes - The maximum size of the response in bytes (0 for no limit), pages end early when the next row doesn't fit
+	 */
+    [[eosio::action, eosio::read_only]]
+    GetModCardsResult listcards(const uint32_t& per_page, const std::optional<name>& cursor, const uint32_t& max_bytes);
+
+	/***
+	 * Lists mods with pagination
+	 * @param per_page - The number of mods to return per page
+	 * @param cursor - An optional cursor to continue listing from (the last mod of the previous page)
+	 * @param max_bytes - The maximum size of the response in bytes (0 for no limit), pages end early when the next row doesn't fit
+	 */
     [[eosio::action, eosio::read_only]]
-    GetModsResult listmods(const uint32_t& per_page, const std::optional<name>& cursor);
+    GetModsResult listmods(const uint32_t& per_page, const std::optional<name>& cursor, const uint32_t& max_bytes);
 
 	// Converts all EOS sent to this contract directly to $A so that it only has to deal with one token internally
     [[eosio::on_notify("eosio.token::transfer")]]
@@ -80,5 +205,6 @@ class [[eosio::contract("market")]] market : public contract {
     private:
     // Ensures that required actions are not dangerous, and hooks are valid & unique
     void validate_action(const totems::RequiredAction& action);
+    ModCard make_card(const totems::Mod& mod);
 
 };
\ No newline at end of file
@@ -9,7 +9,8 @@ void market::publish(
 	const uint64_t& price,
 	const totems::ModDetails& details,
 	const std::vector<totems::RequiredHook>& required_actions,
-	const std::optional<name>& referrer
+	const std::optional<name>& referrer,
+	const binary_extension<std::vector<uint8_t>>& rule
 ) {
 	require_auth(seller);
 	// TODO: Ideally, I would like this to check that this contract, prods.minor, prods.major, or eosio controls
@@ -25,7 +26,13 @@ void market::publish(
 
 	check(price >= 0, "Price cannot be negative");
 	check(is_account(contract), "Contract account does not exist");
-	check(get_code_hash(contract) != checksum256(), "No contract deployed at the given account");
+	if(rule.has_value()){
+		// rule mods are never notified, so they don't need code, but the account still has to be theirs
+		require_auth(contract);
+		rules::validate(rule.value());
+	} else {
+		check(get_code_hash(contract) != checksum256(), "No contract deployed at the given account");
+	}
 
 	mods_table mods(get_self(), get_self().value);
 	auto mod = mods.find(contract.value);
@@ -48,7 +55,7 @@ void market::publish(
     });
 
     shared::ensure_tokens_available(base_fee, get_self());
-    shared::dispense_tokens(get_self(), disbursements);
+    shared::credit_fees(get_self(), disbursements, seller);
 
     check(!details.name.empty(), "Mod name cannot be empty");
     check(!details.summary.empty(), "Mod summary cannot be empty");
@@ -60,22 +67,25 @@ void market::publish(
 
 	check(hooks.size() > 0, "At least one hook must be specified");
 	for(const auto& hook : hooks){
-	    check(std::find(shared::VALID_HOOKS.begin(), shared::VALID_HOOKS.end(), hook) != shared::VALID_HOOKS.end(),
-	        "Unsupported hook: " + hook.to_string());
+	    if(hook == totems::TRANSFERMANY_HOOK){
+	        check(hooks.count("transfer"_n) > 0, "The transfermany hook requires the transfer hook");
+	        continue;
+	    }
+	    check(totems::hook_bit(hook) != 0, "Unsupported hook: " + hook.to_string());
 	}
 
-	std::set<name> seen_required_hooks;
+	uint8_t seen_required_hooks = 0;
 	for(const auto& hook : required_actions){
-		check(seen_required_hooks.find(hook.hook) == seen_required_hooks.end(),
+		const uint8_t bit = totems::hook_bit(hook.hook);
+		check((seen_required_hooks & bit) == 0,
 			"Duplicate required action hook: " + hook.hook.to_string());
-		check(std::find(shared::VALID_HOOKS.begin(), shared::VALID_HOOKS.end(), hook.hook) != shared::VALID_HOOKS.end(),
-			"Unsupported required action hook: " + hook.hook.to_string());
+		check(bit != 0, "Unsupported required action hook: " + hook.hook.to_string());
 
 		for(const auto& action : hook.actions){
 			validate_action(action);
 		}
 
-		seen_required_hooks.insert(hook.hook);
+		seen_required_hooks |= bit;
 	}
 
     mods.emplace(seller, [&](auto& row) {
@@ -85,17 +95,90 @@ void market::publish(
 		row.price = price;
 		row.details = details;
 		row.required_actions = required_actions;
+		// always set, so that hooks_mask (the next extension) can be
+		row.rule = rule.has_value() ? rule.value() : std::vector<uint8_t>{};
+		row.hooks_mask = totems::hook_mask(hooks);
 		row.score = 0;
 		row.published_at = time_point_sec(current_time_point());
 		row.updated_at = time_point_sec(current_time_point());
 	});
 
+	mod_index_table index(get_self(), get_self().value);
+	index.emplace(seller, [&](auto& row) {
+		row = totems::make_mod_index(*mods.find(contract.value));
+	});
 }
 
 void market::update(const name& contract, const uint64_t& price, const totems::ModDetails& details) {
 	// TODO: Not necessary for testnet launch, but will be needed for production
+	// If this ever changes required actions or rules, the hook plans of the totems using the mod
+	// have to be recompiled with the totems contract's `compileplans`.
+}
+
+
+void market::addlicenses(const symbol_code& ticker, const std::vector<name>& mods) {
+	auto totem = totems::get_totem(ticker);
+	check(totem.has_value(), "Totem not found");
+	require_auth(totem.value().creator);
+	check(!mods.empty(), "No mods to license");
+
+	// a mod listed twice is only licensed (and paid for) once
+	std::vector<name> unique_mods = mods;
+	std::sort(unique_mods.begin(), unique_mods.end());
+	unique_mods.erase(std::unique(unique_mods.begin(), unique_mods.end()), unique_mods.end());
+
+	totems::license_set_table licenses(totems::TOTEMS_CONTRACT, totems::TOTEMS_CONTRACT.value);
+	auto licensed = licenses.find(ticker.raw());
+
+	std::vector<shared::FeeDisbursement> disbursements;
+	uint64_t mod_fees = 0;
+	for (const auto& mod_name : unique_mods) {
+		// mods that are already licensed aren't paid for again
+		if (licensed != licenses.end() && licensed->has(mod_name)) continue;
+
+		auto mod = totems::get_mod_index(mod_name);
+		check(mod.has_value(), "Mod is not published in market: " + mod_name.to_string());
+		if (mod.value().price > 0) {
+			mod_fees += mod.value().price;
+			disbursements.push_back(shared::FeeDisbursement{
+				.recipient = mod.value().seller,
+				.amount = mod.value().price
+			});
+		}
+	}
+
+	if (mod_fees > 0) {
+		shared::ensure_tokens_available(mod_fees, get_self());
+		shared::credit_fees(get_self(), disbursements, totem.value().creator);
+	}
+
+	action(
+		permission_level{get_self(), "active"_n},
+		totems::TOTEMS_CONTRACT,
+		"addlicenses"_n,
+		std::make_tuple(ticker, unique_mods)
+	).send();
 }
 
+void market::indexmods(const std::vector<name>& contracts) {
+	require_auth(get_self());
+
+	mods_table mods(get_self(), get_self().value);
+	mod_index_table index(get_self(), get_self().value);
+	for (const auto& contract : contracts) {
+		const auto& mod = mods.get(contract.value, "Mod not found");
+		auto it = index.find(contract.value);
+		if (it == index.end()) {
+			index.emplace(get_self(), [&](auto& row) {
+				row = totems::make_mod_index(mod);
+			});
+		} else {
+			index.modify(it, same_payer, [&](auto& row) {
+				row = totems::make_mod_index(mod);
+			});
+		}
+	}
+}
 
 market::GetModsResult market::getmods(const std::vector<name>& contracts) {
 	mods_table mods(get_self(), get_self().value);
@@ -111,22 +194,18 @@ market::GetModsResult market::getmods(const std::vector<name>& contracts) {
 	return result;
 }
 
-market::GetModsResult market::listmods(const uint32_t& per_page, const std::optional<name>& cursor) {
+market::GetModsResult market::listmods(const uint32_t& per_page, const std::optional<name>& cursor, const uint32_t& max_bytes) {
 	mods_table mods(get_self(), get_self().value);
 	GetModsResult result;
 
-	// use lower bounds for cursor, or just beginning if not provided
-	// (+1 if using cursor to avoid including the cursor item itself)
-	auto mod_itr = mods.begin();
-    if (cursor.has_value()) {
-        mod_itr = mods.lower_bound(cursor->value);
-        if (mod_itr != mods.end()) {
-            ++mod_itr;
-        }
-    }
+	// the cursor is exclusive, and still works if the cursor mod is gone
+	auto mod_itr = cursor.has_value() ? mods.upper_bound(cursor->value) : mods.begin();
 
 	uint32_t count = 0;
+	shared::ResponseBudget budget{max_bytes};
 	while (mod_itr != mods.end() && count < per_page) {
+		if (!budget.fits(*mod_itr)) break;
+
 		result.mods.push_back(*mod_itr);
 		result.cursor = mod_itr->contract;
 		++mod_itr;
@@ -138,6 +217,136 @@ market::GetModsResult market::listmods(const uint32_t& per_page, const std::opti
 	return result;
 }
 
+market::ModCard market::make_card(const totems::Mod& mod) {
+	return ModCard{
+		.contract = mod.contract,
+		.seller = mod.seller,
+		.price = mod.price,
+		.hooks = mod.hooks,
+		.title = mod.details.name,
+		.image = mod.details.image,
+		.is_minter = mod.details.is_minter
+	};
+}
+
+market::GetModCardsResult market::modcards(const std::vector<name>& contracts) {
+	mods_table mods(get_self(), get_self().value);
+	GetModCardsResult result;
+
+	for (const auto& contract : contracts) {
+		auto mod = mods.find(contract.value);
+		if (mod != mods.end()) {
+			result.cards.push_back(make_card(*mod));
+		}
+	}
+
+	return result;
+}
+
+market::GetModCardsResult market::querymods(
+	const ModQuery& query,
+	const uint32_t& per_page,
+	const std::optional<name>& cursor,
+	const uint32_t& max_rows,
+	const uint32_t& max_bytes
+) {
+	mods_table mods(get_self(), get_self().value);
+	mod_index_table index(get_self(), get_self().value);
+	GetModCardsResult result;
+
+	auto matches = [&](const totems::ModIndex& mod) {
+		if (query.seller.has_value() && mod.seller != query.seller.value()) return false;
+		if (query.hook.has_value() && !mod.has_hook(query.hook.value())) return false;
+		if (query.is_minter.has_value() && mod.is_minter != query.is_minter.value()) return false;
+		if (query.min_price.has_value() && mod.price < query.min_price.value()) return false;
+		if (query.max_price.has_value() && mod.price > query.max_price.value()) return false;
+		return true;
+	};
+
+	auto index_itr = cursor.has_value() ? index.upper_bound(cursor->value) : index.begin();
+
+	uint32_t count = 0;
+	uint32_t scanned = 0;
+	shared::ResponseBudget budget{max_bytes};
+	while (index_itr != index.end() && count < per_page && (max_rows == 0 || scanned < max_rows)) {
+		// only matching mods are read in full
+		if (matches(*index_itr)) {
+			auto card = make_card(mods.get(index_itr->contract.value));
+			if (!budget.fits(card)) break;
+			result.cards.push_back(card);
+			++count;
+		}
+
+		// the cursor follows the scan, not the matches, so that the next page doesn't rescan
+		result.cursor = index_itr->contract;
+		++index_itr;
+		++scanned;
+	}
+
+	result.has_more = index_itr != index.end();
+
+	return result;
+}
+
+market::RankModsResult market::rankmods(const uint32_t& per_page, const std::optional<uint128_t>& cursor, const uint32_t& max_bytes) {
+	mods_table mods(get_self(), get_self().value);
+	// usage is tracked by the totems contract as totems are created
+	totems::mod_counts_table counts(totems::TOTEMS_CONTRACT, totems::TOTEMS_CONTRACT.value);
+	auto by_usage = counts.get_index<"byusage"_n>();
+	RankModsResult result;
+
+	// walks down from the most used, the cursor is exclusive
+	auto count_itr = cursor.has_value() ? by_usage.lower_bound(cursor.value()) : by_usage.end();
+
+	uint32_t count = 0;
+	shared::ResponseBudget budget{max_bytes};
+	while (count_itr != by_usage.begin() && count < per_page) {
+		auto next = count_itr;
+		--next;
+
+		auto mod = mods.find(next->mod.value);
+		if (mod != mods.end()) {
+			RankedModCard card{
+				.card = make_card(*mod),
+				.totems = next->totems
+			};
+			if (!budget.fits(card)) break;
+			result.cards.push_back(card);
+			++count;
+		}
+
+		result.cursor = next->by_usage();
+		count_itr = next;
+	}
+
+	result.has_more = count_itr != by_usage.begin();
+
+	return result;
+}
+
+market::GetModCardsResult market::listcards(const uint32_t& per_page, const std::optional<name>& cursor, const uint32_t& max_bytes) {
+	mods_table mods(get_self(), get_self().value);
+	GetModCardsResult result;
+
+	auto mod_itr = cursor.has_value() ? mods.upper_bound(cursor->value) : mods.begin();
+
+	uint32_t count = 0;
+	shared::ResponseBudget budget{max_bytes};
+	while (mod_itr != mods.end() && count < per_page) {
+		auto card = make_card(*mod_itr);
+		if (!budget.fits(card)) break;
+
+		result.cards.push_back(card);
+		result.cursor = mod_itr->contract;
+		++mod_itr;
+		++count;
+	}
+
+	result.has_more = mod_itr != mods.end();
+
+	return result;
+}
+
 
 
 
@@ -50,6 +50,19 @@ CONTRACT freezer : public contract {
 		check(it == frozen.end(), "frozen!");
 	}
 
+	[[eosio::on_notify(TOTEMS_TRANSFERMANY_NOTIFY)]]
+	void on_transfermany(const std::vector<totems::TransferLeg>& legs){
+		frozen_table frozen(get_self(), get_self().value);
+		for(const auto& leg : legs){
+			if(leg.from == get_self() || leg.to == get_self()){
+				continue;
+			}
+
+			auto it = frozen.find(leg.quantity.symbol.code().raw());
+			check(it == frozen.end(), "frozen!");
+		}
+	}
+
 	[[eosio::on_notify(TOTEMS_MINT_NOTIFY)]]
 	void on_mint(const name& mod, const name& minter, const asset& quantity, const asset& payment, const std::string& memo){
 		frozen_table frozen(get_self(), get_self().value);
@@ -19,8 +19,8 @@ CONTRACT minter : public contract {
          action(
 			permission_level{get_self(), "active"_n},
 			totems::TOTEMS_CONTRACT,
-			"transfer"_n,
-			std::make_tuple(get_self(), minter, quantity, std::string("Test Mint"))
+			"mintpay"_n,
+			std::make_tuple(get_self(), minter, quantity)
 		 ).send();
       }
 
@@ -36,6 +36,16 @@ CONTRACT testmod : public contract {
         check_fail();
     }
 
+    [[eosio::on_notify(TOTEMS_TRANSFERMANY_NOTIFY)]]
+    void on_transfermany(const std::vector<totems::TransferLeg>& legs) {
+        check_fail();
+    }
+
+    [[eosio::on_notify(TOTEMS_DELIVER_NOTIFY)]]
+    void on_deliver(const name& mod, const std::vector<totems::HookEvent>& events) {
+        check_fail();
+    }
+
     [[eosio::on_notify(TOTEMS_BURN_NOTIFY)]]
     void on_burn(const name& owner, const asset& quantity, const string& memo) {
         check_fail();
@@ -61,5 +71,14 @@ CONTRACT testmod : public contract {
         check(mod == get_self(), "not this mod");
         check(get_sender() == totems::TOTEMS_CONTRACT, "Only called by the Totems contract!");
         check_fail();
+
+        if(quantity.amount > 0){
+            action(
+                permission_level{get_self(), "active"_n},
+                totems::TOTEMS_CONTRACT,
+                "mintpay"_n,
+                std::make_tuple(get_self(), to, quantity)
+            ).send();
+        }
     }
 };
\ No newline at end of file
@@ -12,10 +12,36 @@ CONTRACT whaleblock : public contract {
 
       [[eosio::on_notify(TOTEMS_TRANSFER_NOTIFY)]]
       void ontransfer(name from, name to, asset quantity, std::string memo){
-         auto totem = totems::get_totem(quantity.symbol.code());
+         check_holdings(to, quantity.symbol);
+      }
+
+      [[eosio::on_notify(TOTEMS_TRANSFERMANY_NOTIFY)]]
+      void ontransfers(const std::vector<totems::TransferLeg>& legs){
+         // a batch can mix in totems that don't use this mod
+         std::vector<symbol_code> skipped;
+         std::vector<symbol_code> installed;
+         for(const auto& leg : legs){
+            const auto ticker = leg.quantity.symbol.code();
+            if(std::find(skipped.begin(), skipped.end(), ticker) != skipped.end()) continue;
+            if(std::find(installed.begin(), installed.end(), ticker) == installed.end()){
+               auto totem = totems::get_totem(ticker);
+               check(totem.has_value(), "Totem does not exist");
+               const auto& mods = totem->mods.transfer;
+               if(std::find(mods.begin(), mods.end(), get_self()) == mods.end()){
+                  skipped.push_back(ticker);
+                  continue;
+               }
+               installed.push_back(ticker);
+            }
+            check_holdings(leg.to, leg.quantity.symbol);
+         }
+      }
+
+      void check_holdings(const name& to, const symbol& ticker){
+         auto totem = totems::get_totem(ticker.code());
          check(totem.has_value(), "Totem does not exist");
 
-         auto balance = totems::get_balance(to, quantity.symbol);
+         auto balance = totems::get_balance(to, ticker);
          int64_t max_holdings = totem->max_supply.amount*0.05;
          // This notification comes AFTER the transfer, so the whale is already holding the new balance
          // and will have exceeded the limit if this check fails.
@@ -8,6 +8,7 @@ CONTRACT remover : public contract {
       using contract::contract;
 
 	  typedef eosio::multi_index<"mods"_n, totems::Mod> mods_table;
+	  typedef eosio::multi_index<"modindex"_n, totems::ModIndex> mod_index_table;
 
 	  ACTION run(){
 	      mods_table mods(get_self(), get_self().value);
@@ -15,5 +16,11 @@ CONTRACT remover : public contract {
 	      while(mod_itr != mods.end()){
 	          mod_itr = mods.erase(mod_itr);
 	      }
+
+	      mod_index_table index(get_self(), get_self().value);
+	      auto index_itr = index.begin();
+	      while(index_itr != index.end()){
+	          index_itr = index.erase(index_itr);
+	      }
 	  }
 };
\ No newline at end of file
@@ -10,16 +10,6 @@ namespace shared {
 	static const symbol EOS_SYMBOL = symbol("EOS", 4);
 	static const symbol VAULTA_SYMBOL = symbol("A", 4);
 
-	// Hooks are triggers for on_notify events in mods
-	std::vector<name> VALID_HOOKS = {
-    	"created"_n,
-    	"mint"_n,
-    	"burn"_n,
-    	"transfer"_n,
-    	"open"_n,
-    	"close"_n
-    };
-
 	void on_eos_transfer(const name& contract, const name& from, const name& to, const asset& quantity, const std::string& memo){
 	    if (to != contract || from == contract) {
 			return;
@@ -48,11 +38,27 @@ namespace shared {
 
     typedef eosio::multi_index<"accounts"_n, CoreBalance> core_balances_table;
 
+	// Total of all fees that are credited but not paid out yet, see the FEE LEDGER below
+	struct [[eosio::table]] FeesOwed {
+		uint64_t amount;
+
+		uint64_t primary_key() const { return 0; }
+	};
+
+	typedef eosio::multi_index<"feesowed"_n, FeesOwed> fees_owed_table;
+
+	uint64_t get_fees_owed(const name& contract) {
+		fees_owed_table fees_owed(contract, contract.value);
+		auto it = fees_owed.find(0);
+		return it == fees_owed.end() ? 0 : it->amount;
+	}
+
 	void ensure_tokens_available(const uint64_t& fee, const name& account) {
         core_balances_table balances("core.vaulta"_n, account.value);
         auto balance = balances.find(VAULTA_SYMBOL.code().raw());
         check(balance != balances.end(), "No balance found for fee payment");
-        check(balance->balance.amount >= fee, "Insufficient balance for fee payment");
+        // fees that are owed are still in the balance, but they aren't available
+        check(static_cast<uint64_t>(balance->balance.amount) >= fee + get_fees_owed(account), "Insufficient balance for fee payment");
     }
 
     struct FeeDisbursement {
@@ -82,6 +88,99 @@ namespace shared {
 		}
 	}
 
+	/* ---------------- FEE LEDGER ---------------- */
+	// Fees are credited to their recipients here instead of being sent inline on every create/mint/publish,
+	// and paid out in bulk with `claim` and `sweepfees`.
+	struct [[eosio::table]] FeeCredit {
+		name recipient;
+		uint64_t amount;
+
+		uint64_t primary_key() const { return recipient.value; }
+	};
+
+	typedef eosio::multi_index<"feeledger"_n, FeeCredit> fee_ledger_table;
+
+	void add_fees_owed(const name& contract, const int64_t& delta, const name& ram_payer) {
+		fees_owed_table fees_owed(contract, contract.value);
+		auto it = fees_owed.find(0);
+		if(it == fees_owed.end()) {
+			fees_owed.emplace(ram_payer, [&](auto& row) {
+				row.amount = delta;
+			});
+		} else {
+			fees_owed.modify(it, same_payer, [&](auto& row) {
+				row.amount += delta;
+			});
+		}
+	}
+
+	void credit_fees(const name& contract, const std::vector<FeeDisbursement>& disbursements, const name& ram_payer) {
+		fee_ledger_table ledger(contract, contract.value);
+		uint64_t total = 0;
+		for (const auto& disbursement : disbursements) {
+			if(disbursement.amount == 0) continue;
+			total += disbursement.amount;
+
+			auto it = ledger.find(disbursement.recipient.value);
+			if(it == ledger.end()) {
+				ledger.emplace(ram_payer, [&](auto& row) {
+					row.recipient = disbursement.recipient;
+					row.amount = disbursement.amount;
+				});
+			} else {
+				ledger.modify(it, same_payer, [&](auto& row) {
+					row.amount += disbursement.amount;
+				});
+			}
+		}
+
+		if(total > 0) add_fees_owed(contract, total, ram_payer);
+	}
+
+	void claim_fees(const name& contract, const name& recipient) {
+		fee_ledger_table ledger(contract, contract.value);
+		const auto& credit = ledger.get(recipient.value, "No fees to claim");
+		const uint64_t amount = credit.amount;
+		ledger.erase(credit);
+
+		add_fees_owed(contract, -static_cast<int64_t>(amount), contract);
+		dispense_tokens(contract, {FeeDisbursement{ .recipient = recipient, .amount = amount }});
+	}
+
+	void sweep_fees(const name& contract, const uint32_t& max_rows) {
+		check(max_rows > 0, "max_rows must be greater than 0");
+
+		fee_ledger_table ledger(contract, contract.value);
+		std::vector<FeeDisbursement> disbursements;
+		uint64_t total = 0;
+		auto it = ledger.begin();
+		while(it != ledger.end() && disbursements.size() < max_rows) {
+			disbursements.push_back(FeeDisbursement{ .recipient = it->recipient, .amount = it->amount });
+			total += it->amount;
+			it = ledger.erase(it);
+		}
+
+		check(!disbursements.empty(), "No fees to sweep");
+		add_fees_owed(contract, -static_cast<int64_t>(total), contract);
+		dispense_tokens(contract, disbursements);
+	}
+
+	/* ---------------- PAGINATION ---------------- */
+	// Keeps read-only listing responses under a size so that they don't run into API node limits.
+	// A max_bytes of 0 means no limit, and the first row always fits so pages can't get stuck.
+	struct ResponseBudget {
+		uint32_t max_bytes;
+		size_t used = 0;
+
+		template<typename T>
+		bool fits(const T& row) {
+			const size_t size = eosio::pack_size(row);
+			if(max_bytes > 0 && used > 0 && used + size > max_bytes) return false;
+			used += size;
+			return true;
+		}
+	};
+
 	struct [[eosio::table]] FeeConfig {
 		uint64_t amount;
 
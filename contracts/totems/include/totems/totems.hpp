@@ -3,10 +3,13 @@
 #include <eosio/asset.hpp>
 #include <eosio/eosio.hpp>
 #include <eosio/system.hpp>
+#include <eosio/singleton.hpp>
 #include "../library/totems.hpp"
 #include "../library/verifier.hpp"
+#include "../library/rules.hpp"
 #include "../shared/shared.hpp"
 #include <string>
+#include <map>
 
 using std::string;
 using namespace eosio;
@@ -17,11 +20,29 @@ class [[eosio::contract("totems")]] totemtoken : public contract {
 
 	// Adds these tables to the contract's ABI
     typedef eosio::multi_index<"accounts"_n, totems::Balance> balances_table;
-    typedef eosio::multi_index<"totems"_n, totems::Totem> totems_table;
-    typedef eosio::multi_index<"totemstats"_n, totems::TotemStats> totemstats_table;
+    typedef totems::totems_table totems_table;
+    typedef totems::totem_meta_table totem_meta_table;
+    typedef totems::totemstats_table totemstats_table;
+    typedef totems::pending_totems_table pending_totems_table;
+    typedef totems::drops_table drops_table;
+    typedef totems::drop_claims_table drop_claims_table;
     typedef eosio::multi_index<"stat"_n, totems::TotemBackwardsCompat> stat_table;
 	typedef eosio::multi_index<"feeconfig"_n, shared::FeeConfig> fee_config_table;
-	typedef eosio::multi_index<"licenses"_n, totems::License> license_table;
+	typedef eosio::multi_index<"feeledger"_n, shared::FeeCredit> fee_ledger_table;
+	typedef eosio::multi_index<"feesowed"_n, shared::FeesOwed> fees_owed_table;
+	typedef totems::license_set_table license_set_table;
+	typedef eosio::multi_index<"hookplans"_n, totems::HookPlan> hookplans_table;
+	typedef totems::hook_subscriptions_table hook_subscriptions_table;
+	typedef totems::hook_queue_table hook_queue_table;
+	typedef totems::async_queues_table async_queues_table;
+	typedef totems::journal_table journal_table;
+	typedef eosio::singleton<"journalstate"_n, totems::JournalState> journal_state_table;
+	typedef totems::ticker_seqs_table ticker_seqs_table;
+	typedef totems::holders_table holders_table;
+	typedef totems::minters_table minters_table;
+	typedef totems::mint_tickets_table mint_tickets_table;
+	typedef totems::mod_usage_table mod_usage_table;
+	typedef totems::mod_counts_table mod_counts_table;
 
 	[[eosio::action]]
 	void setfee(const uint64_t& amount){
@@ -33,6 +54,25 @@ class [[eosio::contract("totems")]] totemtoken : public contract {
 		return shared::get_base_fee(get_self());
 	}
 
+	/***
+	 * Pays out all fees credited to an account
+	 * @param account - The account to pay out
+	 */
+	[[eosio::action]]
+	void claim(const name& account){
+		require_auth(account);
+		shared::claim_fees(get_self(), account);
+	}
+
+	/***
+	 * Pays out credited fees in bulk (anyone can call this, fees only go to their recipients)
+	 * @param max_rows - The maximum number of recipients to pay out
+	 */
+	[[eosio::action]]
+	void sweepfees(const uint32_t& max_rows){
+		shared::sweep_fees(get_self(), max_rows);
+	}
+
 	/***
 	  * Create a new Totem
 	  * @param creator - The account creating the totem
@@ -41,6 +81,8 @@ class [[eosio::contract("totems")]] totemtoken : public contract {
 	  * @param mods - The totem mods to use for each hook
 	  * @param details - The totem details struct for UIs
 	  * @param referrer - Optional referrer account to receive a portion of the creation fee (fee itself doesn't change)
+	  * @param allocation_root - Optional Merkle root of allocations that are only written when claimed with `claimalloc`,
+	  *                          its total is added to max_supply now, and to supply as it is claimed
 	  */
     [[eosio::action]]
     void create(
@@ -49,9 +91,71 @@ class [[eosio::contract("totems")]] totemtoken : public contract {
 		const std::vector<totems::MintAllocation>& allocations,
 		const totems::TotemMods& mods,
 		const totems::TotemDetails& details,
+		const std::optional<name>& referrer,
+		const binary_extension<totems::AllocationRoot>& allocation_root
+	);
+
+	/***
+	  * Claims an allocation from the allocation root of a totem, writing the account's balance
+	  * @param ticker - The totem ticker
+	  * @param index - The leaf index of the allocation
+	  * @param account - The recipient of the allocation (pays for their balance row)
+	  * @param quantity - The allocated quantity
+	  * @param proof - The sibling hashes from the leaf up to the root
+	  */
+    [[eosio::action]]
+    void claimalloc(
+		const symbol_code& ticker,
+		const uint32_t& index,
+		const name& account,
+		const asset& quantity,
+		const std::vector<checksum256>& proof
+	);
+
+	/***
+	  * Starts creating a totem in chunks, for totems with too many allocations to fit into a single `create`.
+	  * Does everything `create` does before the allocations (checks, fees, hook plans and licenses) and takes the ticker.
+	  * @param creator - The account creating the totem
+	  * @param ticker - The symbol/ticker for the totem and its precision (4,TOTEM / 18,ETH)
+	  * @param mods - The totem mods to use for each hook
+	  * @param details - The totem details struct for UIs
+	  * @param referrer - Optional referrer account to receive a portion of the creation fee (fee itself doesn't change)
+	  */
+    [[eosio::action]]
+    void reserve(
+		const name& creator,
+		const symbol& ticker,
+		const totems::TotemMods& mods,
+		const totems::TotemDetails& details,
 		const std::optional<name>& referrer
 	);
 
+	/***
+	  * Writes a batch of allocations for a reserved totem, can be called as many times as needed
+	  * @param ticker - The reserved totem ticker
+	  * @param batch - The allocations to write (at most `MAX_ALLOCATION_BATCH`)
+	  */
+    [[eosio::action]]
+    void allocate(const symbol_code& ticker, const std::vector<totems::MintAllocation>& batch);
+
+	/***
+	  * Finishes creating a reserved totem, its supply & max_supply is the sum of all allocated batches.
+	  * Like `create`, this sends `created` to the mods. The allocations themselves are not copied into `totemmeta`,
+	  * only their number (`allocation_count`).
+	  * @param ticker - The reserved totem ticker
+	  */
+    [[eosio::action]]
+    void finalize(const symbol_code& ticker);
+
+	/***
+	  * Gives up a reserved totem and frees its ticker. The creation fee is not refunded.
+	  * Allocated balances are erased first, at most `MAX_ALLOCATION_BATCH` per call, so a totem with more allocations
+	  * than that needs several calls (the reservation is only removed by the call that erases the last one).
+	  * @param ticker - The reserved totem ticker
+	  */
+    [[eosio::action]]
+    void cancel(const symbol_code& ticker);
+
 	/***
 	  * An action called by the `create` action after a totem is created so that mods can receive the notification after
 	  * all other setup and inlines are done. Mods cannot listen to `create` directly.
@@ -71,6 +175,25 @@ class [[eosio::contract("totems")]] totemtoken : public contract {
     [[eosio::action]]
     void mint(const name& mod, const name& minter, const asset& quantity, const asset& payment, const string& memo);
 
+	/***
+	  * Pays out a mint from the minter mod's balance to the minter. Minter mods should call this from their `mint`
+	  * action instead of `transfer`, it doesn't run the transfer hook again, as the mint hook already ran for it.
+	  * Can only be called once per `mint`, from inside of it, for exactly the minted quantity.
+	  * @param mod - The minter mod paying out the mint
+	  * @param to - The account that requested the mint (the `minter` of the mint)
+	  * @param quantity - The quantity of totems to pay out
+	  */
+    [[eosio::action]]
+    void mintpay(const name& mod, const name& to, const asset& quantity);
+
+	/***
+	  * Sent by `mint` after the minter mod's `mint`, erases the mint ticket if it wasn't paid out
+	  * @param ticker - The totem ticker
+	  * @param mod - The minter mod
+	  */
+    [[eosio::action]]
+    void endmint(const symbol_code& ticker, const name& mod);
+
 	/***
 	  * Burn totems from an account
 	  * @param owner - The account owning the totems to burn
@@ -90,6 +213,17 @@ class [[eosio::contract("totems")]] totemtoken : public contract {
     [[eosio::action]]
 	void transfer(const name& from, const name& to, const asset& quantity, const string& memo);
 
+	/***
+	  * Transfer totems in a batch, each ticker is loaded, verified and notified once.
+	  * Legs are checked in order against the running balances, like separate `transfer`s would be,
+	  * and every balance row is then written once with its net change.
+	  * Mods on the transfer hook receive a single `transfermany` notification with all legs instead of one per transfer,
+	  * so tickers with a transfer mod (other than rule mods) that didn't publish the `transfermany` hook are rejected.
+	  * @param legs - The transfers to make, every `from` must authorize
+	  */
+    [[eosio::action]]
+	void transfermany(const std::vector<totems::TransferLeg>& legs);
+
 	/***
 	  * Open a totem balance for an account (RAM payer pays for the storage)
 	  * @param owner - The account to open the balance for
@@ -107,6 +241,133 @@ class [[eosio::contract("totems")]] totemtoken : public contract {
     [[eosio::action]]
     void close(const name& owner, const symbol& ticker);
 
+	/***
+	  * Sets the native policies of a totem, which are checked by the totems contract itself instead of by mods
+	  * @param ticker - The totem ticker
+	  * @param policy - The policy (frozen, holding cap in basis points of max_supply, paused hooks as hook bits)
+	  */
+    [[eosio::action]]
+    void setpolicy(const symbol_code& ticker, const totems::TotemPolicy& policy);
+
+	/***
+	  * Sets the subscription filter of a mod for a hook of a totem, the mod is then only notified of matching operations
+	  * @param ticker - The totem ticker
+	  * @param hook - The hook to filter [transfer, mint, burn, open, close, created]
+	  * @param filter - The filter, its `mod` has to authorize this and be used by the totem on this hook
+	  */
+    [[eosio::action]]
+    void subscribe(const symbol_code& ticker, const name& hook, const totems::HookFilter& filter);
+
+	/***
+	  * Removes the subscription filter of a mod, the mod is notified of every operation on the hook again
+	  * @param mod - The mod unsubscribing
+	  * @param ticker - The totem ticker
+	  * @param hook - The hook to stop filtering
+	  */
+    [[eosio::action]]
+    void unsubscribe(const name& mod, const symbol_code& ticker, const name& hook);
+
+	/***
+	  * Delivers the queued events of an async mod (anyone can call this, events only go to their mod)
+	  * @param mod - The mod to deliver events to
+	  * @param max_events - The maximum number of events to deliver (at most `MAX_CRANK_EVENTS`)
+	  */
+    [[eosio::action]]
+    void crank(const name& mod, const uint32_t& max_events);
+
+	/***
+	  * Sent by `crank` to notify a mod of a batch of its queued events, oldest first
+	  * @param mod - The mod receiving the events
+	  * @param events - The events
+	  */
+    [[eosio::action]]
+    void deliver(const name& mod, const std::vector<totems::HookEvent>& events);
+
+	/***
+	  * Drops the oldest queued events of an async mod without delivering them,
+	  * so an event the mod can't process doesn't block the rest of its queue
+	  * @param mod - The mod skipping its events
+	  * @param max_events - The number of events to drop (at most `MAX_CRANK_EVENTS`)
+	  */
+    [[eosio::action]]
+    void skipevents(const name& mod, const uint32_t& max_events);
+
+	/***
+	  * Recompiles the hook plans of a totem from the current market data,
+	  * to pick up changes to the required actions or rules of its mods (plans are not refreshed on their own).
+	  * Can be called by the contract or the totem creator, who then pays for the RAM of the plans.
+	  * @param ticker - The totem ticker to recompile
+	  */
+    [[eosio::action]]
+    void compileplans(const symbol_code& ticker);
+
+	/***
+	  * Copies totems from the legacy single-row `totems` table into the `totemcore` and `totemmeta` tables,
+	  * compiles their hook plans and adds their stats to the ranking indices (see `reindexstats`).
+	  * Totems can't be used until they are migrated, so this has to run for every legacy totem right after the upgrade.
+	  * The legacy rows are kept (and their supply kept up to date) so that mods built against the old library
+	  * can still read them, until they are dropped with `droplegacy`.
+	  * @param max_rows - The maximum number of legacy rows to look at in this call
+	  * @param cursor - The last ticker looked at by the previous call (exclusive), or null to start over
+	  */
+    [[eosio::action]]
+    void migrate(const uint32_t& max_rows, const std::optional<symbol_code>& cursor);
+
+	/***
+	  * Erases migrated rows from the legacy `totems` table, once the mods reading it have been rebuilt
+	  * @param max_rows - The maximum number of legacy rows to erase in this call
+	  */
+    [[eosio::action]]
+    void droplegacy(const uint32_t& max_rows);
+
+	/***
+	  * Rebuilds the `holders` rows of the given owners from their balances (for balances that existed before the holders table)
+	  * @param ticker - The totem ticker
+	  * @param owners - The accounts to sync
+	  */
+    [[eosio::action]]
+    void syncholders(const symbol_code& ticker, const std::vector<name>& owners);
+
+	/***
+	  * Re-inserts `totemstats` rows that were created before the ranking indices existed so that they show up in `ranktotems`.
+	  * Modifying such a row fails, `migrate` reindexes the stats of every totem it copies so that this is only needed for
+	  * stats rows that aren't reached through `migrate`.
+	  * @param tickers - The totems to reindex (already indexed totems are skipped)
+	  */
+    [[eosio::action]]
+    void reindexstats(const std::vector<symbol_code>& tickers);
+
+	/***
+	  * Writes the `modusage` and `modcounts` rows of totems that were created before mod usage was tracked
+	  * @param tickers - The totems to sync (mods that already have a usage row for the totem are skipped)
+	  */
+    [[eosio::action]]
+    void syncusage(const std::vector<symbol_code>& tickers);
+
+	/***
+	  * Writes the `minters` rows of totems that were created before the minter registry existed
+	  * @param tickers - The totems to sync
+	  */
+    [[eosio::action]]
+    void syncminters(const std::vector<symbol_code>& tickers);
+
+	/***
+	  * Adds licenses for mods to an existing totem, only callable by the market (see `market::addlicenses`)
+	  * @param ticker - The totem ticker
+	  * @param mods - The mods to license
+	  */
+    [[eosio::action]]
+    void addlicenses(const symbol_code& ticker, const std::vector<name>& mods);
+
+	/***
+	  * Moves the per-mod `licenses` rows of the given totems into their `licenseset` row.
+	  * Mods built against the old library only read the old rows, so this should only be run
+	  * for a totem once its mods have been rebuilt.
+	  * @param tickers - The totems to migrate
+	  */
+    [[eosio::action]]
+    void migratelics(const std::vector<symbol_code>& tickers);
+
 	/***
 	  * Get the total fee for using the given mods
 	  * @param mods - A vector of mod account names to get the total fee for
@@ -117,6 +378,7 @@ class [[eosio::contract("totems")]] totemtoken : public contract {
 
     struct TotemAndStats {
         totems::Totem totem;
+        totems::TotemMeta meta;
         totems::TotemStats stats;
     };
 
@@ -133,23 +395,209 @@ class [[eosio::contract("totems")]] totemtoken : public contract {
 	  * Lists totems with pagination
 	  * @param per_page - The number of totems to return per page
 	  * @param cursor - An optional cursor to continue listing from (a totem's symbol code raw value)
+	  * @param max_bytes - The maximum size of the response in bytes (0 for no limit), pages end early when the next row doesn't fit
+	  */
+	[[eosio::action, eosio::read_only]]
+	GetTotemsResult listtotems(const uint32_t& per_page, const std::optional<uint64_t>& cursor, const uint32_t& max_bytes);
+
+	// Only what UIs need to show a totem in a list, so listings don't serialize allocations, mods and details
+	struct TotemCard {
+		symbol ticker;
+		std::string title;
+		std::string image;
+		name creator;
+		asset supply;
+		asset max_supply;
+		uint64_t holders;
+	};
+
+	struct GetTotemCardsResult {
+		std::vector<TotemCard> cards;
+		uint64_t cursor;
+		bool has_more;
+	};
+
+	/***
+	  * Same as `gettotems`, but returns cards instead of full totems
+	  * @param tickers - The totems to get cards for
+	  */
+	[[eosio::action, eosio::read_only]]
+	GetTotemCardsResult totemcards(const std::vector<symbol_code>& tickers);
+
+	/***
+	  * Same as `listtotems`, but returns cards instead of full totems
+	  * @param per_page - The number of totems to return per page
+	  * @param cursor - An optional cursor to continue listing from (a totem's symbol code raw value)
+	  * @param max_bytes - The maximum size of the response in bytes (0 for no limit), pages end early when the next row doesn't fit
+	  */
+	[[eosio::action, eosio::read_only]]
+	GetTotemCardsResult listcards(const uint32_t& per_page, const std::optional<uint64_t>& cursor, const uint32_t& max_bytes);
+
+	// Filters for `querytotems`, every set filter has to match
+	struct TotemQuery {
+		std::optional<name> creator;
+		// totems that use this mod on any hook (or on `hook` if it is set)
+		std::optional<name> uses_mod;
+		// totems with at least one mod on this hook
+		std::optional<name> hook;
+		uint64_t min_holders;
+		uint64_t min_transfers;
+		uint64_t min_mints;
+	};
+
+	/***
+	  * Finds totems matching a query, returned as cards in ticker order (by creator when `creator` is set)
+	  * @param query - The filters to match
+	  * @param per_page - The maximum number of matches to return
+	  * @param cursor - An optional cursor to continue scanning from (the cursor of the previous page)
+	  * @param max_rows - The maximum number of totems to scan in this call (0 for no limit), a page can have no matches but still has_more
+	  * @param max_bytes - The maximum size of the response in bytes (0 for no limit), pages end early when the next row doesn't fit
+	  */
+	[[eosio::action, eosio::read_only]]
+	GetTotemCardsResult querytotems(
+		const TotemQuery& query,
+		const uint32_t& per_page,
+		const std::optional<uint64_t>& cursor,
+		const uint32_t& max_rows,
+		const uint32_t& max_bytes
+	);
+
+	/***
+	  * Lists the totems created by an account with pagination
+	  * @param creator - The account that created the totems
+	  * @param per_page - The number of totems to return per page
+	  * @param cursor - An optional cursor to continue listing from (a totem's symbol code raw value)
+	  * @param max_bytes - The maximum size of the response in bytes (0 for no limit), pages end early when the next row doesn't fit
+	  */
+	[[eosio::action, eosio::read_only]]
+	GetTotemsResult listcreator(const name& creator, const uint32_t& per_page, const std::optional<uint64_t>& cursor, const uint32_t& max_bytes);
+
+	struct GetRecentTotemsResult {
+		std::vector<TotemAndStats> results;
+		// The `bycreated` key (created_at << 64 | ticker) of the last returned totem
+		uint128_t cursor;
+		bool has_more;
+	};
+
+	/***
+	  * Lists totems with pagination, newest first
+	  * @param per_page - The number of totems to return per page
+	  * @param cursor - An optional cursor to continue listing from (the cursor of the previous page), still works if that totem is gone
+	  * @param max_bytes - The maximum size of the response in bytes (0 for no limit), pages end early when the next row doesn't fit
 	  */
 	[[eosio::action, eosio::read_only]]
-	GetTotemsResult listtotems(const uint32_t& per_page, const std::optional<uint64_t>& cursor);
+	GetRecentTotemsResult listrecent(const uint32_t& per_page, const std::optional<uint128_t>& cursor, const uint32_t& max_bytes);
 
 	struct AccountBalance {
 		name account;
 		asset balance;
 	};
 
+	// The last (account, ticker) that was returned
+	struct BalancesCursor {
+		name account;
+		symbol_code ticker;
+	};
+
 	struct GetBalancesResult {
 		std::vector<AccountBalance> balances;
+		BalancesCursor cursor;
+		bool has_more;
+	};
+
+	/***
+	  * Gets the balances of accounts, ordered by account and then ticker
+	  * @param accounts - The accounts to get balances for
+	  * @param tickers - The tickers to get balances for (empty for all of them)
+	  * @param per_page - The maximum number of balances to return
+	  * @param cursor - An optional cursor to continue from (the cursor of the previous page)
+	  * @param max_bytes - The maximum size of the response in bytes (0 for no limit), pages end early when the next row doesn't fit
+	  */
+	[[eosio::action, eosio::read_only]]
+	GetBalancesResult getbalances(
+		const std::vector<name>& accounts,
+		const std::vector<symbol_code>& tickers,
+		const uint32_t& per_page,
+		const std::optional<BalancesCursor>& cursor,
+		const uint32_t& max_bytes
+	);
+
+	struct RankTotemsResult {
+		std::vector<totems::TotemStats> results;
+		uint128_t cursor;
+		bool has_more;
+	};
+
+	/***
+	  * Ranks totems by one of their stats, highest first
+	  * @param metric - The stat to rank by [holders, transfers, mints]
+	  * @param per_page - The number of totems to return per page
+	  * @param cursor - An optional cursor to continue ranking from (the cursor of the previous page)
+	  * @param max_bytes - The maximum size of the response in bytes (0 for no limit), pages end early when the next row doesn't fit
+	  */
+	[[eosio::action, eosio::read_only]]
+	RankTotemsResult ranktotems(const name& metric, const uint32_t& per_page, const std::optional<uint128_t>& cursor, const uint32_t& max_bytes);
+
+	struct TotemsByModResult {
+		std::vector<totems::ModUsage> usages;
+		uint64_t cursor;
+		bool has_more;
+	};
+
+	/***
+	  * Lists the totems that use a mod and on which hooks
+	  * @param mod - The mod contract
+	  * @param cursor - An optional cursor to continue listing from (a totem's symbol code raw value)
+	  * @param per_page - The number of totems to return per page
+	  * @param max_bytes - The maximum size of the response in bytes (0 for no limit), pages end early when the next row doesn't fit
+	  */
+	[[eosio::action, eosio::read_only]]
+	TotemsByModResult totemsbymod(const name& mod, const std::optional<uint64_t>& cursor, const uint32_t& per_page, const uint32_t& max_bytes);
+
+	struct GetHoldersResult {
+		std::vector<totems::Holder> holders;
 		name cursor;
 		bool has_more;
 	};
 
+	/***
+	  * Lists the holders of a totem with pagination, ordered by account
+	  * @param ticker - The totem ticker
+	  * @param cursor - An optional cursor to continue listing from (the last account of the previous page)
+	  * @param per_page - The number of holders to return per page
+	  * @param max_bytes - The maximum size of the response in bytes (0 for no limit), pages end early when the next row doesn't fit
+	  */
+	[[eosio::action, eosio::read_only]]
+	GetHoldersResult getholders(const symbol_code& ticker, const std::optional<name>& cursor, const uint32_t& per_page, const uint32_t& max_bytes);
+
+	/***
+	  * Gets the largest holders of a totem, largest first
+	  * @param ticker - The totem ticker
+	  * @param n - The number of holders to return (at most `MAX_TOP_HOLDERS`)
+	  */
+	[[eosio::action, eosio::read_only]]
+	std::vector<totems::Holder> topholders(const symbol_code& ticker, const uint32_t& n);
+
+	struct GetEventsResult {
+		std::vector<totems::JournalEvent> events;
+		// The seq of the last returned event (or `since_seq` when there are none)
+		uint64_t cursor;
+		bool has_more;
+		// The oldest seq that is still in the journal
+		uint64_t oldest_seq;
+		// True if events after `since_seq` were overwritten before they were read
+		bool gap;
+	};
+
+	/***
+	  * Gets the journal events after a sequence number, oldest first.
+	  * Only the last `JOURNAL_SIZE` events are kept, followers that fell further behind continue from the oldest one
+	  * with `gap` set, and have to resync the events before `oldest_seq` from somewhere else.
+	  * @param since_seq - The last seq that was already synced (0 to start from the oldest event)
+	  * @param max - The maximum number of events to return (at most `MAX_EVENTS_PAGE`)
+	  */
 	[[eosio::action, eosio::read_only]]
-	GetBalancesResult getbalances(const std::vector<name>& accounts, const std::vector<symbol_code>& tickers);
+	GetEventsResult events(const uint64_t& since_seq, const uint32_t& max);
 
 	/***
 	  * Converts all EOS sent to this contract directly to $A so that it only has to deal with one token internally
@@ -161,13 +609,126 @@ class [[eosio::contract("totems")]] totemtoken : public contract {
 
     using create_action = eosio::action_wrapper<"create"_n, &totemtoken::create>;
     using mint_action = eosio::action_wrapper<"mint"_n, &totemtoken::mint>;
+    using mintpay_action = eosio::action_wrapper<"mintpay"_n, &totemtoken::mintpay>;
     using burn_action = eosio::action_wrapper<"burn"_n, &totemtoken::burn>;
     using transfer_action = eosio::action_wrapper<"transfer"_n, &totemtoken::transfer>;
+    using transfermany_action = eosio::action_wrapper<"transfermany"_n, &totemtoken::transfermany>;
     using open_action = eosio::action_wrapper<"open"_n, &totemtoken::open>;
     using close_action = eosio::action_wrapper<"close"_n, &totemtoken::close>;
 
+	// The most allocations a single `allocate` call can write
+	static constexpr uint32_t MAX_ALLOCATION_BATCH = 100;
+	// The most events a single `crank` call can deliver
+	static constexpr uint32_t MAX_CRANK_EVENTS = 100;
+	// The most events a single `events` call can return
+	static constexpr uint32_t MAX_EVENTS_PAGE = 100;
+	// The most holders a single `topholders` call can return
+	static constexpr uint32_t MAX_TOP_HOLDERS = 100;
+
    private:
+    // An event to append to the journal, the helper fills in the sequence numbers and time
+    struct JournalEntry {
+        name kind;
+        name from;
+        name to;
+        int64_t amount;
+    };
+
+    // The layout of totems before they were split into `totemcore` and `totemmeta`, only used by `migrate`,
+    // `droplegacy`, and `burn` to keep the supply of legacy rows up to date
+    struct LegacyTotem {
+        name creator;
+        asset supply;
+        asset max_supply;
+        std::vector<totems::MintAllocation> allocations;
+        totems::TotemMods mods;
+        totems::TotemDetails details;
+        time_point_sec created_at;
+        time_point_sec updated_at;
+
+        uint64_t primary_key() const { return max_supply.symbol.code().raw(); }
+    };
+
+    typedef eosio::multi_index<"totems"_n, LegacyTotem> legacy_totems_table;
+
+    // The per-ticker license rows from before `licenseset`, only read by `migratelics`
+    typedef totems::license_table legacy_license_table;
+    // `totemstats` without its ranking indices, only used by `reindexstats`
+    typedef eosio::multi_index<"totemstats"_n, totems::TotemStats> unindexed_totemstats_table;
+
+    // everything `create` does before the allocations are written
+    void reserve_totem(
+		const name& creator,
+		const symbol& ticker,
+		const totems::TotemMods& mods,
+		const totems::TotemDetails& details,
+		const std::optional<name>& referrer
+	);
+    // writes allocation balances and minters, adding them to the running supply and stats
+    void write_allocations(
+		const name& creator,
+		const symbol& ticker,
+		const std::vector<totems::MintAllocation>& allocations,
+		asset& supply,
+		totems::TotemStats& stats
+	);
+    // writes the totem rows and sends `created`
+    void finalize_totem(
+		const name& creator,
+		const asset& supply,
+		const asset& max_supply,
+		const totems::TotemMods& mods,
+		const std::vector<totems::MintAllocation>& allocations,
+		const uint32_t& allocation_count,
+		const totems::TotemDetails& details,
+		const totems::TotemStats& stats
+	);
+    // appends events of one totem to the journal
+    void journal(const symbol_code& ticker, const std::vector<JournalEntry>& entries);
+    // reverts if a transfer mod of the totem would not see the legs of a `transfermany`
+    void check_batchable(const totems::Totem& totem);
     void sub_balance(const name& owner, const asset& value);
-    void add_balance(const name& owner, const asset& value, const name& ram_payer, const bool& skip_stats = false);
-    void notify_mods(const std::vector<name>& mods);
+    // returns true if a new balance row was created
+    bool add_balance(const name& owner, const asset& value, const name& ram_payer, const bool& skip_stats = false);
+    bool matches(const TotemQuery& query, const totems::Totem& totem, const totems::TotemStats& stats);
+    TotemCard make_card(const totems::Totem& totem, const totems::TotemMeta& meta, const totems::TotemStats& stats);
+    // merges mods into the sorted license set of a ticker
+    void add_licenses(const symbol_code& ticker, const std::vector<name>& mods, const name& ram_payer);
+    void record_mod_usage(const symbol_code& ticker, const name& mod, const uint8_t& hooks, const name& ram_payer);
+    // keeps the `holders` row of an owner in line with their balance
+    void set_holder(const name& owner, const symbol_code& ticker, const int64_t& amount, const name& ram_payer);
+    // notifies every mod that isn't in `skip` (rule mods that already ran inline) and whose filter matches one of the operations
+    void notify_mods(
+		const symbol_code& ticker,
+		const name& hook,
+		const std::vector<name>& mods,
+		const std::vector<name>& skip,
+		const std::vector<rules::Operation>& ops
+	);
+    // queues the operations that match an async filter, returns false if the mod's queue is full
+    bool enqueue_events(const totems::HookFilter& filter, const name& hook, const std::vector<rules::Operation>& ops);
+    // removes up to max_events from the head of a mod's queue and returns them, oldest first
+    std::vector<totems::HookEvent> pop_events(const name& mod, const uint32_t& max_events);
+    // fails if the totem is frozen or the hook is paused
+    void check_policy(const totems::Totem& totem, const totems::Hook& hook);
+    // fails if the owner's balance is over the totem's holding cap
+    void check_holding(const totems::Totem& totem, const name& owner);
+    // fails if a balance amount is over the totem's holding cap
+    void check_holding(const totems::Totem& totem, const int64_t& amount);
+    // re-inserts a stats row that has no ranking index entries yet
+    void reindex_stats(const symbol_code& ticker);
+    // erases the hook plans of a totem and compiles them again from the market
+    void compile_plans(const totems::Totem& totem, const name& ram_payer);
+    void save_hook_plan(
+		const symbol_code& ticker,
+		const name& hook,
+		const std::vector<totems::PlanAction>& plan,
+		const std::vector<totems::ModRule>& rules,
+		const name& ram_payer
+	);
+    // verifies the required actions of a hook and runs its rules on the operations, returns the rule mods that ran
+    std::vector<name> verify_hook(const name& sender, const symbol_code& ticker, const name& hook, const std::vector<rules::Operation>& ops);
+    int64_t rule_field(const rules::Operation& op, const rules::Field& field);
+    // sha256 of the packed transaction
+    checksum256 transaction_id();
 };
\ No newline at end of file
@@ -6,10 +6,243 @@ void totemtoken::create(
 	const std::vector<totems::MintAllocation>& allocations,
 	const totems::TotemMods& mods,
 	const totems::TotemDetails& details,
+	const std::optional<name>& referrer,
+	const binary_extension<totems::AllocationRoot>& allocation_root
+) {
+    require_auth(creator);
+
+    reserve_totem(creator, ticker, mods, details, referrer);
+
+	totems::TotemStats stats {
+		.ticker = ticker,
+		.mints = 0,
+		.burns = 0,
+		.transfers = 0,
+		.holders = 0
+	};
+    asset supply = asset(0, ticker);
+    write_allocations(creator, ticker, allocations, supply, stats);
+
+    // lazy allocations only count towards supply once they are claimed
+    asset max_supply = supply;
+    if(allocation_root.has_value()){
+        const auto& root = allocation_root.value();
+        check(root.total.is_valid(), "invalid allocation root total");
+        check(root.total.amount > 0, "allocation root total must be positive");
+        check(root.total.symbol == ticker, "allocation symbol mismatch");
+        check(root.leaves > 0, "allocation root has no leaves");
+        max_supply += root.total;
+
+        drops_table drops(get_self(), get_self().value);
+        drops.emplace(creator, [&](auto& row) {
+            row.ticker = ticker;
+            row.allocations = root;
+            row.claimed = asset(0, ticker);
+            row.claims = 0;
+        });
+    }
+
+    finalize_totem(creator, supply, max_supply, mods, allocations, allocations.size(), details, stats);
+}
+
+void totemtoken::claimalloc(
+	const symbol_code& ticker,
+	const uint32_t& index,
+	const name& account,
+	const asset& quantity,
+	const std::vector<checksum256>& proof
+) {
+    require_auth(account);
+
+    drops_table drops(get_self(), get_self().value);
+    auto drop = drops.find(ticker.raw());
+    check(drop != drops.end(), "Totem has no allocation root");
+    check(index < drop->allocations.leaves, "Invalid allocation index");
+    check(quantity.is_valid(), "invalid quantity");
+    check(quantity.amount > 0, "allocation quantity must be positive");
+    check(quantity.symbol == drop->ticker, "allocation symbol mismatch");
+    check(
+        totems::verify_merkle_proof(totems::allocation_leaf(index, account, quantity), proof, drop->allocations.root),
+        "Invalid allocation proof"
+    );
+
+    drop_claims_table claimed(get_self(), ticker.raw());
+    const uint64_t word = index / 64;
+    const uint64_t bit = 1ULL << (index % 64);
+    auto claims = claimed.find(word);
+    if(claims == claimed.end()){
+        claimed.emplace(account, [&](auto& row) {
+            row.word = word;
+            row.bits = bit;
+        });
+    } else {
+        check((claims->bits & bit) == 0, "Allocation already claimed");
+        claimed.modify(claims, same_payer, [&](auto& row) {
+            row.bits |= bit;
+        });
+    }
+
+    check(drop->claimed + quantity <= drop->allocations.total, "Claims exceed the allocation root total");
+    drops.modify(drop, same_payer, [&](auto& row) {
+        row.claimed += quantity;
+        row.claims += 1;
+    });
+
+    totems_table totems(get_self(), get_self().value);
+    auto totem = totems.find(ticker.raw());
+    check(totem != totems.end(), "Totem not found");
+    // a claim creates supply like a mint does
+    check_policy(*totem, totems::Hook::MINT);
+    totems.modify(totem, same_payer, [&](auto& row) {
+        row.supply += quantity;
+    });
+
+    // backwards compat
+    stat_table statstable(get_self(), ticker.raw());
+    statstable.modify(statstable.get(ticker.raw()), same_payer, [&](auto& s) {
+	   s.supply += quantity;
+	});
+
+    totemstats_table totemstats(get_self(), get_self().value);
+    auto stats = totemstats.find(ticker.raw());
+    check(stats != totemstats.end(), "Totem stats not found");
+    totemstats.modify(stats, same_payer, [&](auto& row) {
+        row.mints += 1;
+    });
+
+    // counts the holder if this is a new balance
+    add_balance(account, quantity, account);
+    check_holding(*totem, account);
+
+    journal(ticker, {{"claim"_n, name(), account, quantity.amount}});
+}
+
+void totemtoken::reserve(
+	const name& creator,
+	const symbol& ticker,
+	const totems::TotemMods& mods,
+	const totems::TotemDetails& details,
 	const std::optional<name>& referrer
 ) {
     require_auth(creator);
 
+    reserve_totem(creator, ticker, mods, details, referrer);
+
+    pending_totems_table pendings(get_self(), get_self().value);
+    pendings.emplace(creator, [&](auto& row) {
+        row.ticker = ticker;
+        row.creator = creator;
+        row.mods = mods;
+        row.details = details;
+        row.supply = asset(0, ticker);
+        row.allocations = 0;
+        row.mints = 0;
+        row.holders = 0;
+    });
+}
+
+void totemtoken::allocate(const symbol_code& ticker, const std::vector<totems::MintAllocation>& batch) {
+    pending_totems_table pendings(get_self(), get_self().value);
+    auto pending = pendings.find(ticker.raw());
+    check(pending != pendings.end(), "Totem is not reserved");
+    require_auth(pending->creator);
+
+    check(batch.size() > 0, "No allocations");
+    check(batch.size() <= MAX_ALLOCATION_BATCH, "Too many allocations in one batch");
+
+	totems::TotemStats stats {
+		.ticker = pending->ticker,
+		.mints = pending->mints,
+		.burns = 0,
+		.transfers = 0,
+		.holders = pending->holders
+	};
+    asset supply = pending->supply;
+    write_allocations(pending->creator, pending->ticker, batch, supply, stats);
+
+    pendings.modify(pending, same_payer, [&](auto& row) {
+        row.supply = supply;
+        row.allocations += batch.size();
+        row.mints = stats.mints;
+        row.holders = stats.holders;
+    });
+}
+
+void totemtoken::finalize(const symbol_code& ticker) {
+    pending_totems_table pendings(get_self(), get_self().value);
+    auto pending = pendings.find(ticker.raw());
+    check(pending != pendings.end(), "Totem is not reserved");
+    require_auth(pending->creator);
+
+	totems::TotemStats stats {
+		.ticker = pending->ticker,
+		.mints = pending->mints,
+		.burns = 0,
+		.transfers = 0,
+		.holders = pending->holders
+	};
+    finalize_totem(pending->creator, pending->supply, pending->supply, pending->mods, {}, pending->allocations, pending->details, stats);
+
+    pendings.erase(pending);
+}
+
+void totemtoken::cancel(const symbol_code& ticker) {
+    pending_totems_table pendings(get_self(), get_self().value);
+    auto pending = pendings.find(ticker.raw());
+    check(pending != pendings.end(), "Totem is not reserved");
+    require_auth(pending->creator);
+
+    // allocated balances are taken back first, every allocation recipient is a holder of the pending totem
+    holders_table holders(get_self(), ticker.raw());
+    uint32_t count = 0;
+    for(auto holder = holders.begin(); holder != holders.end() && count < MAX_ALLOCATION_BATCH; ++count){
+        balances_table balances(get_self(), holder->owner.value);
+        balances.erase(balances.get(ticker.raw(), "no balance object found"));
+        holder = holders.erase(holder);
+    }
+    if(holders.begin() != holders.end()) return;
+
+    // then everything `reserve` wrote for the ticker, so that it can be reserved again
+    hookplans_table hookplans(get_self(), ticker.raw());
+    for(auto plan = hookplans.begin(); plan != hookplans.end();) plan = hookplans.erase(plan);
+
+    minters_table minters(get_self(), ticker.raw());
+    for(auto minter = minters.begin(); minter != minters.end();) minter = minters.erase(minter);
+
+    license_set_table licenses(get_self(), get_self().value);
+    auto license = licenses.find(ticker.raw());
+    if(license != licenses.end()) licenses.erase(license);
+
+    std::vector<name> used;
+    for(const auto& hook : totems::ALL_HOOKS){
+        for(const auto& mod : pending->mods[hook]) used.push_back(mod);
+    }
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+
+    mod_counts_table counts(get_self(), get_self().value);
+    for(const auto& mod : used){
+        mod_usage_table usages(get_self(), mod.value);
+        auto usage = usages.find(ticker.raw());
+        if(usage != usages.end()) usages.erase(usage);
+
+        auto mod_count = counts.find(mod.value);
+        if(mod_count == counts.end()) continue;
+        if(mod_count->totems <= 1) counts.erase(mod_count);
+        else counts.modify(mod_count, same_payer, [&](auto& row) { row.totems -= 1; });
+    }
+
+    journal(ticker, {{"cancel"_n, pending->creator, name(), pending->supply.amount}});
+    pendings.erase(pending);
+}
+
+void totemtoken::reserve_totem(
+	const name& creator,
+	const symbol& ticker,
+	const totems::TotemMods& mods,
+	const totems::TotemDetails& details,
+	const std::optional<name>& referrer
+) {
     check(ticker.is_valid(), "Invalid ticker");
     check(details.name.size() <= 32, "Totem name too long");
     check(details.name.size() >= 3, "Totem name too short");
@@ -20,6 +253,10 @@ void totemtoken::create(
     // TODO: Check global registry instead
     totems_table totems(get_self(), get_self().value);
     check(totems.find(ticker.code().raw()) == totems.end(), "A totem with this symbol already exists");
+    legacy_totems_table legacy_totems(get_self(), get_self().value);
+    check(legacy_totems.find(ticker.code().raw()) == legacy_totems.end(), "A totem with this symbol already exists");
+    pending_totems_table pendings(get_self(), get_self().value);
+    check(pendings.find(ticker.code().raw()) == pendings.end(), "A totem with this symbol already exists");
 
     uint64_t mod_fees = 0;
 
@@ -38,29 +275,38 @@ void totemtoken::create(
 		.amount = network_fee
 	});
 
-	std::vector<std::pair<name, totems::Mod>> mod_cache;
-    auto get_cached = [&](const name& mod_name) -> std::optional<totems::Mod> {
+	// Only the compact index rows are read for the checks, the full mod
+	// is only read when it has required actions that need to go into a plan.
+	std::vector<std::pair<name, totems::ModIndex>> mod_cache;
+    auto get_mod = [&](const name& mod_name) -> std::optional<totems::ModIndex> {
         for (const auto& [k, v] : mod_cache) if (k == mod_name) return v;
-        return std::nullopt;
-    };
 
-    auto cache_mod = [&](const name& mod_name, const totems::Mod& mod) {
-        mod_cache.emplace_back(mod_name, mod);
+        auto mod = totems::get_mod_index(mod_name);
+        if (mod.has_value()) mod_cache.emplace_back(mod_name, mod.value());
+        return mod;
     };
 
-    auto get_mod = [&](const name& mod_name) -> std::optional<totems::Mod> {
-        if (auto cached = get_cached(mod_name)) return cached;
+    const auto no_required_actions = totems::required_actions_digest({});
+    std::vector<std::pair<name, totems::Mod>> full_mod_cache;
+    auto get_full_mod = [&](const name& mod_name) -> const totems::Mod& {
+        for (const auto& [k, v] : full_mod_cache) if (k == mod_name) return v;
 
         auto mod = totems::get_mod(mod_name);
-        if (mod.has_value()) cache_mod(mod_name, mod.value());
-        return mod;
+        check(mod.has_value(), "Mod is not published in market");
+        full_mod_cache.emplace_back(mod_name, mod.value());
+        return full_mod_cache.back().second;
     };
 
-	auto iterate_mods = [&](const std::vector<name>& mod_list, const name& hook_name) {
-		for (const auto& mod_name : mod_list) {
+	// every mod with the hooks it is used on
+	std::map<name, uint8_t> mod_hooks;
+	for (const auto& hook : totems::ALL_HOOKS) {
+		const name hook_name = totems::hook_name(hook);
+		std::vector<totems::PlanAction> plan;
+		std::vector<totems::ModRule> hook_rules;
+		for (const auto& mod_name : mods[hook]) {
             auto mod = get_mod(mod_name);
             check(mod.has_value(), "Mod is not published in market");
-            check(mod.value().has_hook(hook_name), "Mod does not support required hook: " + hook_name.to_string());
+            check(mod.value().has_hook(hook), "Mod does not support required hook: " + hook_name.to_string());
             auto price = mod.value().price;
             if(price > 0){
 	            mod_fees += mod.value().price;
@@ -69,105 +315,127 @@ void totemtoken::create(
 	                .amount = mod.value().price
 	            });
             }
+
+            if(mod.value().required_actions_digest != no_required_actions){
+                totems::merge_into_plan(plan, get_full_mod(mod_name), hook_name);
+            }
+            if(mod.value().has_rule){
+                hook_rules.push_back(totems::ModRule{ .mod = mod_name, .program = get_full_mod(mod_name).rule.value() });
+            }
+            mod_hooks[mod_name] |= totems::hook_bit(hook);
         }
-	};
 
-	iterate_mods(mods.transfer, "transfer"_n);
-	iterate_mods(mods.mint, "mint"_n);
-	iterate_mods(mods.burn, "burn"_n);
-	iterate_mods(mods.open, "open"_n);
-	iterate_mods(mods.close, "close"_n);
-	iterate_mods(mods.created, "created"_n);
+		save_hook_plan(ticker.code(), hook_name, plan, hook_rules, creator);
+	}
 
 	{
-		std::set<name> unique;
-        auto add = [&](const std::vector<name>& v) {
-            unique.insert(v.begin(), v.end());
-        };
-
-        add(mods.transfer);
-        add(mods.mint);
-        add(mods.burn);
-        add(mods.open);
-        add(mods.close);
-        add(mods.created);
-
-        std::vector<name> all_mods(unique.begin(), unique.end());
-
-        totems::license_table licenses(get_self(), ticker.code().raw());
-        for(const auto& mod : all_mods){
-            licenses.emplace(get_self(), [&](auto& row){
-                row.mod = mod;
-            });
+        // std::map is ordered, so these are already sorted for the license set
+        std::vector<name> licensed;
+        for(const auto& [mod, hooks] : mod_hooks){
+            licensed.push_back(mod);
+            record_mod_usage(ticker.code(), mod, hooks, creator);
         }
+        add_licenses(ticker.code(), licensed, get_self());
 	}
 
 
 
 	shared::ensure_tokens_available(base_fee + mod_fees, get_self());
-	shared::dispense_tokens(get_self(), disbursements);
-
-	totemstats_table totemstats(get_self(), get_self().value);
-	totems::TotemStats stats {
-		.ticker = ticker,
-		.mints = 0,
-		.burns = 0,
-		.transfers = 0,
-		.holders = 0
-	};
+	shared::credit_fees(get_self(), disbursements, creator);
+}
 
+void totemtoken::write_allocations(
+	const name& creator,
+	const symbol& ticker,
+	const std::vector<totems::MintAllocation>& allocations,
+	asset& supply,
+	totems::TotemStats& stats
+) {
 	// tally up max supply from allocations, and send tokens to recipients
-    asset max_supply = asset(0, ticker);
+    minters_table minters(get_self(), ticker.code().raw());
+    std::vector<JournalEntry> entries;
+    entries.reserve(allocations.size());
     for (const auto& alloc : allocations) {
         check(alloc.quantity.is_valid(), "invalid supply in allocation");
         check(alloc.quantity.amount > 0, "allocation quantity must be positive");
         check(alloc.quantity.symbol == ticker, "allocation symbol mismatch");
-        max_supply += alloc.quantity;
+        supply += alloc.quantity;
 
 		// chain up allocation transfers
-		add_balance(alloc.recipient, alloc.quantity, creator, true);
+		const bool new_holder = add_balance(alloc.recipient, alloc.quantity, creator, true);
+		entries.push_back({"allocate"_n, creator, alloc.recipient, alloc.quantity.amount});
 
 		if(alloc.is_minter.has_value() && alloc.is_minter.value()) {
-			auto mod = get_mod(alloc.recipient);
+			auto mod = totems::get_mod_index(alloc.recipient);
 			check(mod.has_value(), "Allocation recipient mod is not published in market: " + alloc.recipient.to_string());
-			check(mod.value().details.is_minter, "Allocation recipient mod is not a minter: " + alloc.recipient.to_string());
+			check(mod.value().is_minter, "Allocation recipient mod is not a minter: " + alloc.recipient.to_string());
+
+			if(minters.find(alloc.recipient.value) == minters.end()){
+				minters.emplace(creator, [&](auto& row) {
+					row.mod = alloc.recipient;
+				});
+			}
 		} else {
 			stats.mints += 1;
-			stats.holders += 1;
+			// recipients that already got an allocation (in this batch or an earlier one) are already counted
+			if(new_holder) stats.holders += 1;
 		}
     }
 
+    journal(ticker.code(), entries);
+}
+
+void totemtoken::finalize_totem(
+	const name& creator,
+	const asset& supply,
+	const asset& max_supply,
+	const totems::TotemMods& mods,
+	const std::vector<totems::MintAllocation>& allocations,
+	const uint32_t& allocation_count,
+	const totems::TotemDetails& details,
+	const totems::TotemStats& stats
+) {
     check(max_supply.amount > 0, "Totem initial allocation must be greater than 0");
 
+    totems_table totems(get_self(), get_self().value);
     totems.emplace(creator, [&](auto& row) {
-    	row.supply = max_supply;
+    	row.supply = supply;
     	row.max_supply = max_supply;
         row.creator = creator;
-        row.allocations = allocations;
         row.mods = mods;
+    });
+
+    totem_meta_table metas(get_self(), get_self().value);
+    metas.emplace(creator, [&](auto& row) {
+        row.ticker = supply.symbol;
+        row.allocations = allocations;
+        row.allocation_count = allocation_count;
         row.details = details;
         row.created_at = time_point_sec(current_time_point());
         row.updated_at = time_point_sec(current_time_point());
     });
 
+	totemstats_table totemstats(get_self(), get_self().value);
     totemstats.emplace(creator, [&](auto& row) {
     	row = stats;
 	});
 
 	// purely used for backwards compatibility with wallets and
 	// other tools that expect standard token tables
-	stat_table statstable(get_self(), ticker.code().raw());
+	stat_table statstable(get_self(), supply.symbol.code().raw());
 	statstable.emplace(creator, [&](auto& s) {
-	   s.supply     = max_supply;
+	   s.supply     = supply;
 	   s.max_supply = max_supply;
 	   s.issuer     = creator;
 	});
 
+	journal(supply.symbol.code(), {{"create"_n, creator, name(), max_supply.amount}});
+
 	action(
 		permission_level{get_self(), "active"_n},
 		get_self(),
 		"created"_n,
-		std::make_tuple(creator, ticker)
+		std::make_tuple(creator, supply.symbol)
 	).send();
 }
 
@@ -178,13 +446,12 @@ void totemtoken::created(const name& creator, const symbol& ticker) {
 	auto totem = totems.find(ticker.code().raw());
 	check(totem != totems.end(), "Totem not found");
 
-	action_verifier::verify(
-		creator,
-		ticker.code(),
-		totems::get_required_actions("created"_n, totem->mods.created)
-	);
+	const std::vector<rules::Operation> ops{
+		rules::Operation{creator, creator, asset(0, ticker), totem->supply, totem->max_supply, ""}
+	};
+	const auto ruled = verify_hook(creator, ticker.code(), "created"_n, ops);
 
-	notify_mods(totem->mods.created);
+	notify_mods(ticker.code(), "created"_n, totem->mods.created, ruled, ops);
 }
 
 void totemtoken::mint(const name& mod, const name& minter, const asset& quantity, const asset& payment, const string& memo) {
@@ -194,15 +461,15 @@ void totemtoken::mint(const name& mod, const name& minter, const asset& quantity
     check(payment.symbol.is_valid(), "invalid symbol name");
 	check(payment.symbol == shared::EOS_SYMBOL || payment.symbol == shared::VAULTA_SYMBOL, "payment must be in EOS or VAULTA");
 
-	// Sending the payment for this mint from the contract to the Mod
+	// Crediting the payment for this mint to the Mod
 	if(payment.amount > 0){
 		shared::ensure_tokens_available(payment.amount, get_self());
-	    shared::dispense_tokens(get_self(), {
+	    shared::credit_fees(get_self(), {
 	        shared::FeeDisbursement{
 	            .recipient = mod,
 	            .amount = static_cast<uint64_t>(payment.amount)
 	        }
-	    });
+	    }, minter);
     }
 
     totems_table totems(get_self(), get_self().value);
@@ -211,21 +478,23 @@ void totemtoken::mint(const name& mod, const name& minter, const asset& quantity
 
 	check(quantity.is_valid(), "invalid quantity");
 	check(quantity.symbol == totem->supply.symbol, "symbol precision mismatch");
-
-	auto found_mod = std::find_if(
-        totem->allocations.begin(),
-        totem->allocations.end(),
-        [&](const totems::MintAllocation& alloc) {
-            return alloc.recipient == mod;
-        }
-    );
-
-	check(found_mod != totem->allocations.end(), "Mod not authorized to mint for this totem");
-	check(found_mod->is_minter.has_value() && found_mod->is_minter.value(), "Mod is not authorized to mint");
-
-	auto modDetails = totems::get_mod(mod);
-	check(modDetails.has_value(), "Mod is not published in market");
-	check(modDetails.value().details.is_minter, "Mod is not a minter");
+	check_policy(*totem, totems::Hook::MINT);
+
+	// minter allocations were checked against the market on creation
+	minters_table minters(get_self(), quantity.symbol.code().raw());
+	check(minters.find(mod.value) != minters.end(), "Mod not authorized to mint for this totem");
+
+	// lets the mod pay this mint out with `mintpay`
+	mint_tickets_table tickets(get_self(), quantity.symbol.code().raw());
+	auto write_ticket = [&](auto& row) {
+		row.mod = mod;
+		row.minter = minter;
+		row.quantity = quantity;
+		row.transaction_id = transaction_id();
+	};
+	auto ticket = tickets.find(mod.value);
+	if(ticket == tickets.end()) tickets.emplace(minter, write_ticket);
+	else tickets.modify(ticket, same_payer, write_ticket);
 
 	action(
         permission_level{get_self(), "active"_n},
@@ -234,6 +503,14 @@ void totemtoken::mint(const name& mod, const name& minter, const asset& quantity
         std::make_tuple(mod, minter, quantity, asset(payment.amount, shared::VAULTA_SYMBOL), std::move(memo))
     ).send();
 
+	// runs after the mod's `mint` and everything it sent inline, so the ticket can't be used later
+	action(
+        permission_level{get_self(), "active"_n},
+        get_self(),
+        "endmint"_n,
+        std::make_tuple(quantity.symbol.code(), mod)
+    ).send();
+
 	// TODO: If this is enabled, then you need to make the supply not count minter mods.
 	// That introduced a bunch of complexity on the modder side though, as there's not way to
 	// get back a result about how many tokens the user would have gotten.
@@ -252,14 +529,49 @@ void totemtoken::mint(const name& mod, const name& minter, const asset& quantity
 		row.mints += 1;
 	});
 
-	action_verifier::verify(
-        minter,
-        quantity.symbol.code(),
-        totems::get_required_actions("mint"_n, totem->mods.mint)
-    );
+	const std::vector<rules::Operation> ops{
+		rules::Operation{mod, minter, quantity, totem->supply, totem->max_supply, memo}
+	};
+	const auto ruled = verify_hook(minter, quantity.symbol.code(), "mint"_n, ops);
+	journal(quantity.symbol.code(), {{"mint"_n, mod, minter, quantity.amount}});
+
+
+    notify_mods(quantity.symbol.code(), "mint"_n, totem->mods.mint, ruled, ops);
+}
+
+void totemtoken::mintpay(const name& mod, const name& to, const asset& quantity) {
+	require_auth(mod);
+
+	mint_tickets_table tickets(get_self(), quantity.symbol.code().raw());
+	const auto& ticket = tickets.get(mod.value, "No mint to pay out");
+	check(ticket.minter == to, "Mint can only be paid out to its minter");
+	check(ticket.quantity == quantity, "Mint can only be paid out for the minted quantity");
+	check(ticket.transaction_id == transaction_id(), "Mint can only be paid out in its own transaction");
+	tickets.erase(ticket);
+
+	totems_table totems(get_self(), get_self().value);
+	const auto& totem = totems.get(quantity.symbol.code().raw(), "Totem not found");
+
+	check(quantity.is_valid(), "invalid quantity");
+	check(quantity.amount > 0, "must transfer positive quantity");
+	check(quantity.symbol == totem.supply.symbol, "symbol precision mismatch");
+	check_policy(totem, totems::Hook::MINT);
+
+	// the mint hook already ran for this in `mint`, so this only moves the balance
+	require_recipient(to);
+	sub_balance(mod, quantity);
+	add_balance(to, quantity, mod);
+	check_holding(totem, to);
 
+	journal(quantity.symbol.code(), {{"mintpay"_n, mod, to, quantity.amount}});
+}
+
+void totemtoken::endmint(const symbol_code& ticker, const name& mod) {
+	require_auth(get_self());
 
-    notify_mods(totem->mods.mint);
+	mint_tickets_table tickets(get_self(), ticker.raw());
+	auto ticket = tickets.find(mod.value);
+	if(ticket != tickets.end()) tickets.erase(ticket);
 }
 
 void totemtoken::burn(const name& owner, const asset& quantity, const string& memo) {
@@ -273,6 +585,7 @@ void totemtoken::burn(const name& owner, const asset& quantity, const string& me
     check(totem != totems.end(), "token with symbol does not exist");
 
     check(quantity.symbol == totem->supply.symbol, "symbol precision mismatch");
+    check_policy(*totem, totems::Hook::BURN);
 
     totems.modify(totem, same_payer, [&](auto& row) {
         row.supply -= quantity;
@@ -286,6 +599,15 @@ void totemtoken::burn(const name& owner, const asset& quantity, const string& me
 	   s.supply -= quantity;
 	});
 
+    // mods built against the old library still read the legacy `totems` row until it is dropped
+    legacy_totems_table legacy_totems(get_self(), get_self().value);
+    auto legacy = legacy_totems.find(quantity.symbol.code().raw());
+    if (legacy != legacy_totems.end()) {
+        legacy_totems.modify(legacy, same_payer, [&](auto& row) {
+            row.supply -= quantity;
+        });
+    }
+
     totemstats_table totemstats(get_self(), get_self().value);
     auto stats = totemstats.find(totem->supply.symbol.code().raw());
     check(stats != totemstats.end(), "Totem stats not found");
@@ -295,13 +617,13 @@ void totemtoken::burn(const name& owner, const asset& quantity, const string& me
 
     sub_balance(owner, quantity);
 
-    action_verifier::verify(
-        owner,
-        quantity.symbol.code(),
-        totems::get_required_actions("burn"_n, totem->mods.burn)
-    );
+    const std::vector<rules::Operation> ops{
+        rules::Operation{owner, name(), quantity, totem->supply, totem->max_supply, memo}
+    };
+    const auto ruled = verify_hook(owner, quantity.symbol.code(), "burn"_n, ops);
+    journal(quantity.symbol.code(), {{"burn"_n, owner, name(), quantity.amount}});
 
-    notify_mods(totem->mods.burn);
+    notify_mods(quantity.symbol.code(), "burn"_n, totem->mods.burn, ruled, ops);
 }
 
 void totemtoken::transfer(const name& from, const name& to, const asset& quantity, const string& memo) {
@@ -314,6 +636,7 @@ void totemtoken::transfer(const name& from, const name& to, const asset& quantit
     totems_table totems(get_self(), get_self().value);
     const auto& totem = totems.get(quantity.symbol.code().raw());
     check(quantity.symbol == totem.supply.symbol, "symbol precision mismatch");
+    check_policy(totem, totems::Hook::TRANSFER);
 
 	auto from_is_mod = std::find(
 		totem.mods.transfer.begin(),
@@ -334,6 +657,7 @@ void totemtoken::transfer(const name& from, const name& to, const asset& quantit
 
     sub_balance(from, quantity);
     add_balance(to, quantity, payer);
+    check_holding(totem, to);
 
     totemstats_table totemstats(get_self(), get_self().value);
     auto stats = totemstats.find(quantity.symbol.code().raw());
@@ -342,13 +666,189 @@ void totemtoken::transfer(const name& from, const name& to, const asset& quantit
         row.transfers += 1;
     });
 
-    action_verifier::verify(
-        from,
-        quantity.symbol.code(),
-        totems::get_required_actions("transfer"_n, totem.mods.transfer)
-    );
+    const std::vector<rules::Operation> ops{
+        rules::Operation{from, to, quantity, totem.supply, totem.max_supply, memo}
+    };
+    const auto ruled = verify_hook(from, quantity.symbol.code(), "transfer"_n, ops);
+    journal(quantity.symbol.code(), {{"transfer"_n, from, to, quantity.amount}});
+
+    notify_mods(quantity.symbol.code(), "transfer"_n, totem.mods.transfer, ruled, ops);
+}
+
+void totemtoken::transfermany(const std::vector<totems::TransferLeg>& legs) {
+	check(!legs.empty(), "No transfers given");
+
+	struct TickerBatch {
+		const totems::Totem* totem;
+		uint64_t transfers = 0;
+		uint64_t new_holders = 0;
+		std::vector<name> senders;
+	};
+
+	// a balance row as it is during the batch, written once at the end
+	struct BalanceState {
+		name owner;
+		symbol ticker;
+		bool exists;
+		int64_t start;
+		int64_t amount;
+		name ram_payer;
+	};
+
+	totems_table totems(get_self(), get_self().value);
+	std::vector<TickerBatch> batches;
+	std::vector<BalanceState> states;
+
+	auto get_batch = [&](const symbol& ticker) -> TickerBatch& {
+		for (auto& batch : batches) if (batch.totem->max_supply.symbol.code() == ticker.code()) return batch;
+		batches.push_back(TickerBatch{ .totem = &totems.get(ticker.code().raw(), "ticker does not exist"), .senders = {} });
+		check_policy(*batches.back().totem, totems::Hook::TRANSFER);
+		check_batchable(*batches.back().totem);
+		return batches.back();
+	};
+
+	auto get_state = [&](const name& owner, const symbol& ticker) -> BalanceState& {
+		for (auto& state : states) if (state.owner == owner && state.ticker == ticker) return state;
+		balances_table balances(get_self(), owner.value);
+		auto row = balances.find(ticker.code().raw());
+		const int64_t amount = row == balances.end() ? 0 : row->balance.amount;
+		states.push_back(BalanceState{ .owner = owner, .ticker = ticker, .exists = row != balances.end(), .start = amount, .amount = amount, .ram_payer = name() });
+		return states.back();
+	};
+
+	// legs are checked in order against the running balances, like separate transfers would be
+	for (const auto& leg : legs) {
+		require_auth(leg.from);
+		check(leg.from != leg.to, "cannot transfer to self");
+		check(is_account(leg.to), "to account does not exist");
+		check(leg.quantity.is_valid(), "invalid quantity");
+		check(leg.quantity.amount > 0, "must transfer positive quantity of " + leg.quantity.symbol.code().to_string());
+
+		auto& batch = get_batch(leg.quantity.symbol);
+		const auto& mods = batch.totem->mods.transfer;
+		check(leg.quantity.symbol == batch.totem->supply.symbol, "symbol precision mismatch");
+
+		if (std::find(mods.begin(), mods.end(), leg.from) == mods.end()) require_recipient(leg.from);
+		if (std::find(mods.begin(), mods.end(), leg.to) == mods.end()) require_recipient(leg.to);
+
+		auto& from = get_state(leg.from, leg.quantity.symbol);
+		check(from.exists, "no balance object found");
+		check(from.amount >= leg.quantity.amount, "overdrawn balance of " + leg.quantity.symbol.code().to_string());
+		from.amount -= leg.quantity.amount;
+
+		auto& to = get_state(leg.to, leg.quantity.symbol);
+		to.amount += leg.quantity.amount;
+		// the first leg that creates the row pays for it
+		if (!to.exists && to.ram_payer == name()) to.ram_payer = has_auth(leg.to) ? leg.to : leg.from;
+		check_holding(*batch.totem, to.amount);
+
+		batch.transfers += 1;
+		if (std::find(batch.senders.begin(), batch.senders.end(), leg.from) == batch.senders.end()) {
+			batch.senders.push_back(leg.from);
+		}
+	}
+
+	// every balance row is written once with its net change
+	for (const auto& state : states) {
+		if (!state.exists) {
+			add_balance(state.owner, asset(state.amount, state.ticker), state.ram_payer, true);
+			get_batch(state.ticker).new_holders += 1;
+		} else if (state.amount < state.start) {
+			sub_balance(state.owner, asset(state.start - state.amount, state.ticker));
+		} else if (state.amount > state.start) {
+			add_balance(state.owner, asset(state.amount - state.start, state.ticker), state.owner, true);
+		}
+	}
+
+	totemstats_table totemstats(get_self(), get_self().value);
+	for (const auto& batch : batches) {
+		const auto& ticker = batch.totem->max_supply.symbol;
+
+		auto stats = totemstats.find(ticker.code().raw());
+		check(stats != totemstats.end(), "Totem stats not found");
+		totemstats.modify(stats, same_payer, [&](auto& row) {
+			row.transfers += batch.transfers;
+			row.holders += batch.new_holders;
+		});
+
+		// every leg goes through the rules, grouped by the sender that has to verify them
+		std::vector<name> ruled;
+		std::vector<rules::Operation> batch_ops;
+		for (const auto& sender : batch.senders) {
+			std::vector<rules::Operation> ops;
+			for (const auto& leg : legs) {
+				if (leg.from != sender || leg.quantity.symbol != ticker) continue;
+				ops.push_back(rules::Operation{leg.from, leg.to, leg.quantity, batch.totem->supply, batch.totem->max_supply, leg.memo});
+			}
+			ruled = verify_hook(sender, ticker.code(), "transfer"_n, ops);
+			batch_ops.insert(batch_ops.end(), ops.begin(), ops.end());
+		}
+
+		// every leg is journaled in the order it was given
+		std::vector<JournalEntry> entries;
+		for (const auto& leg : legs) {
+			if (leg.quantity.symbol != ticker) continue;
+			entries.push_back({"transfer"_n, leg.from, leg.to, leg.quantity.amount});
+		}
+		journal(ticker.code(), entries);
+
+		// mods with a filter are notified if any leg matches it
+		notify_mods(ticker.code(), "transfer"_n, batch.totem->mods.transfer, ruled, batch_ops);
+	}
+}
+
+void totemtoken::journal(const symbol_code& ticker, const std::vector<JournalEntry>& entries) {
+    if (entries.empty()) return;
+
+    journal_state_table state(get_self(), get_self().value);
+    auto global = state.get_or_default();
+
+    ticker_seqs_table ticker_seqs(get_self(), get_self().value);
+    auto ticker_seq = ticker_seqs.find(ticker.raw());
+    uint64_t last = ticker_seq == ticker_seqs.end() ? 0 : ticker_seq->last_seq;
+
+    journal_table journal(get_self(), get_self().value);
+    const auto now = time_point_sec(current_time_point());
+    for (const auto& entry : entries) {
+        const totems::JournalEvent event{
+            .seq = ++global.last_seq,
+            .ticker_seq = ++last,
+            .kind = entry.kind,
+            .ticker = ticker,
+            .from = entry.from,
+            .to = entry.to,
+            .amount = entry.amount,
+            .time = now
+        };
+
+        // once the ring is full, the oldest event's slot is reused (and its RAM with it)
+        auto slot = journal.find(event.primary_key());
+        if (slot == journal.end()) journal.emplace(get_self(), [&](auto& row) { row = event; });
+        else journal.modify(slot, same_payer, [&](auto& row) { row = event; });
+    }
+
+    state.set(global, get_self());
+    if (ticker_seq == ticker_seqs.end()) {
+        ticker_seqs.emplace(get_self(), [&](auto& row) {
+            row.ticker = ticker;
+            row.last_seq = last;
+        });
+    } else {
+        ticker_seqs.modify(ticker_seq, same_payer, [&](auto& row) {
+            row.last_seq = last;
+        });
+    }
+}
 
-    notify_mods(totem.mods.transfer);
+void totemtoken::check_batchable(const totems::Totem& totem) {
+    // rule mods run on every leg, every other transfer mod has to handle `transfermany` notifications
+    for (const auto& mod_name : totem.mods.transfer) {
+        auto mod = totems::get_mod_index(mod_name);
+        check(mod.has_value(), "Mod is not published in market: " + mod_name.to_string());
+        if (mod.value().has_rule) continue;
+        check(mod.value().handles_transfermany(),
+            "Transfer mod does not support transfermany: " + mod_name.to_string());
+    }
 }
 
 void totemtoken::sub_balance(const name& owner, const asset& value) {
@@ -358,13 +858,15 @@ void totemtoken::sub_balance(const name& owner, const asset& value) {
     check(from.balance.amount >= value.amount, "overdrawn balance of " + value.symbol.code().to_string());
 
     balances.modify(from, owner, [&](auto& a) { a.balance -= value; });
+    set_holder(owner, value.symbol.code(), from.balance.amount, owner);
 }
 
-void totemtoken::add_balance(const name& owner, const asset& value, const name& ram_payer, const bool& skip_stats) {
+bool totemtoken::add_balance(const name& owner, const asset& value, const name& ram_payer, const bool& skip_stats) {
     balances_table balances(get_self(), owner.value);
     auto to = balances.find(value.symbol.code().raw());
     if (to == balances.end()) {
         balances.emplace(ram_payer, [&](auto& a) { a.balance = value; });
+        set_holder(owner, value.symbol.code(), value.amount, ram_payer);
 
 		if(!skip_stats){
             totemstats_table totemstats(get_self(), get_self().value);
@@ -374,8 +876,26 @@ void totemtoken::add_balance(const name& owner, const asset& value, const name&
 	            row.holders += 1;
 	        });
         }
+        return true;
+    }
+
+    balances.modify(to, same_payer, [&](auto& a) { a.balance += value; });
+    set_holder(owner, value.symbol.code(), to->balance.amount, ram_payer);
+    return false;
+}
+
+void totemtoken::set_holder(const name& owner, const symbol_code& ticker, const int64_t& amount, const name& ram_payer) {
+    holders_table holders(get_self(), ticker.raw());
+    auto it = holders.find(owner.value);
+    if (it == holders.end()) {
+        holders.emplace(ram_payer, [&](auto& row) {
+            row.owner = owner;
+            row.amount = static_cast<uint64_t>(amount);
+        });
     } else {
-        balances.modify(to, same_payer, [&](auto& a) { a.balance += value; });
+        holders.modify(it, same_payer, [&](auto& row) {
+            row.amount = static_cast<uint64_t>(amount);
+        });
     }
 }
 
@@ -388,20 +908,22 @@ void totemtoken::open(const name& owner, const symbol& ticker, const name& ram_p
     totems_table totems(get_self(), get_self().value);
     const auto& totem = totems.get(sym_code_raw, "ticker does not exist");
     check(totem.supply.symbol == ticker, "ticker precision mismatch");
+    check_policy(totem, totems::Hook::OPEN);
 
     balances_table balances(get_self(), owner.value);
     auto it = balances.find(sym_code_raw);
     if (it == balances.end()) {
         balances.emplace(ram_payer, [&](auto& a) { a.balance = asset{0, ticker}; });
+        set_holder(owner, ticker.code(), 0, ram_payer);
+        journal(ticker.code(), {{"open"_n, owner, name(), 0}});
     }
 
-    action_verifier::verify(
-        owner,
-        ticker.code(),
-        totems::get_required_actions("open"_n, totem.mods.open)
-    );
+    const std::vector<rules::Operation> ops{
+        rules::Operation{owner, owner, asset(0, ticker), totem.supply, totem.max_supply, ""}
+    };
+    const auto ruled = verify_hook(owner, ticker.code(), "open"_n, ops);
 
-    notify_mods(totem.mods.open);
+    notify_mods(ticker.code(), "open"_n, totem.mods.open, ruled, ops);
 }
 
 void totemtoken::close(const name& owner, const symbol& ticker) {
@@ -409,6 +931,7 @@ void totemtoken::close(const name& owner, const symbol& ticker) {
 
     totems_table totems(get_self(), get_self().value);
     const auto& totem = totems.get(ticker.code().raw(), "ticker does not exist");
+    check_policy(totem, totems::Hook::CLOSE);
 
     balances_table balances(get_self(), owner.value);
     auto it = balances.find(ticker.code().raw());
@@ -416,6 +939,12 @@ void totemtoken::close(const name& owner, const symbol& ticker) {
     check(it->balance.amount == 0, "Cannot close because the balance is not zero.");
     balances.erase(it);
 
+    holders_table holders(get_self(), ticker.code().raw());
+    auto holder = holders.find(owner.value);
+    if (holder != holders.end()) {
+        holders.erase(holder);
+    }
+
     totemstats_table totemstats(get_self(), get_self().value);
     auto stats = totemstats.find(ticker.code().raw());
     check(stats != totemstats.end(), "Totem stats not found");
@@ -423,107 +952,975 @@ void totemtoken::close(const name& owner, const symbol& ticker) {
         row.holders -= 1;
     });
 
-    action_verifier::verify(
-        owner,
-        ticker.code(),
-        totems::get_required_actions("close"_n, totem.mods.close)
-    );
-
-    notify_mods(totem.mods.close);
-}
+    const std::vector<rules::Operation> ops{
+        rules::Operation{owner, owner, asset(0, ticker), totem.supply, totem.max_supply, ""}
+    };
+    const auto ruled = verify_hook(owner, ticker.code(), "close"_n, ops);
+    journal(ticker.code(), {{"close"_n, owner, name(), 0}});
 
-void totemtoken::notify_mods(const std::vector<name>& mods) {
-    for (const auto& mod : mods) {
-        require_recipient(mod);
-    }
+    notify_mods(ticker.code(), "close"_n, totem.mods.close, ruled, ops);
 }
 
+void totemtoken::setpolicy(const symbol_code& ticker, const totems::TotemPolicy& policy) {
+	totems_table totems(get_self(), get_self().value);
+	auto totem = totems.find(ticker.raw());
+	check(totem != totems.end(), "Totem not found");
+	require_auth(totem->creator);
 
-// READ ONLY
-uint64_t totemtoken::getfee(const std::vector<name> mods){
-	uint64_t mod_fees = 0;
-	for (const auto& mod_name : mods) {
-        auto mod = totems::get_mod(mod_name);
-        check(mod.has_value(), "Mod is not published in market");
-        mod_fees += mod.value().price;
-    }
+	check(policy.max_holding_bps <= 10000, "Holding cap can't be over 10000 basis points");
+	check(policy.paused_hooks < (1 << totems::HOOK_COUNT), "Invalid paused hooks");
 
-    return mod_fees + shared::get_base_fee(get_self());
+	totems.modify(totem, same_payer, [&](auto& row) {
+		row.policy = policy;
+	});
 }
 
-totemtoken::GetTotemsResult totemtoken::gettotems(const std::vector<symbol_code>& tickers){
-	totems_table totems(get_self(), get_self().value);
-	GetTotemsResult result;
+void totemtoken::check_policy(const totems::Totem& totem, const totems::Hook& hook) {
+	if(!totem.policy.has_value()) return;
 
-	totemstats_table totemstats(get_self(), get_self().value);
-	for(const auto& code : tickers){
-		auto totem_itr = totems.find(code.raw());
-		if(totem_itr != totems.end()){
-			auto stats = totemstats.find(totem_itr->max_supply.symbol.code().raw());
-            result.results.push_back(TotemAndStats{
-                .totem = *totem_itr,
-                .stats = *stats
-            });
-		}
+	const auto& policy = totem.policy.value();
+	if(hook == totems::Hook::TRANSFER || hook == totems::Hook::MINT || hook == totems::Hook::BURN){
+		check(!policy.frozen, "Totem is frozen");
 	}
-	return result;
+	check(!policy.is_paused(hook), "Totem " + totems::hook_name(hook).to_string() + " is paused");
 }
 
-totemtoken::GetTotemsResult totemtoken::listtotems(const uint32_t& per_page, const std::optional<uint64_t>& cursor){
-	totems_table totems(get_self(), get_self().value);
-	GetTotemsResult result;
+void totemtoken::check_holding(const totems::Totem& totem, const name& owner) {
+	if(!totem.policy.has_value() || totem.policy.value().max_holding_bps == 0) return;
 
-	auto totem_itr = totems.begin();
-	if(cursor.has_value()){
-		totem_itr = totems.find(cursor.value());
-		if(totem_itr != totems.end()){
-			++totem_itr;
-		}
-	}
+	balances_table balances(get_self(), owner.value);
+	const auto& balance = balances.get(totem.max_supply.symbol.code().raw(), "no balance object found");
+	check_holding(totem, balance.balance.amount);
+}
 
-	uint32_t count = 0;
-	totemstats_table totemstats(get_self(), get_self().value);
-	while(totem_itr != totems.end() && count < per_page){
-		auto stats = totemstats.find(totem_itr->max_supply.symbol.code().raw());
-		result.results.push_back(TotemAndStats{
-			.totem = *totem_itr,
-			.stats = *stats
-		});
-		result.cursor = totem_itr->max_supply.symbol.code().raw();
-		++totem_itr;
-		++count;
-	}
+void totemtoken::check_holding(const totems::Totem& totem, const int64_t& amount) {
+	if(!totem.policy.has_value() || totem.policy.value().max_holding_bps == 0) return;
 
-	result.has_more = totem_itr != totems.end();
+	const int64_t max_holding = static_cast<int64_t>(
+		static_cast<uint128_t>(totem.max_supply.amount) * totem.policy.value().max_holding_bps / 10000
+	);
+	check(amount <= max_holding, "Cannot hold more than the totem's holding cap");
+}
+
+void totemtoken::notify_mods(
+	const symbol_code& ticker,
+	const name& hook,
+	const std::vector<name>& mods,
+	const std::vector<name>& skip,
+	const std::vector<rules::Operation>& ops
+) {
+    if (mods.empty()) return;
+
+    hook_subscriptions_table subscriptions(get_self(), ticker.raw());
+    auto subs = subscriptions.find(hook.value);
+
+    for (const auto& mod : mods) {
+        if (!skip.empty() && std::find(skip.begin(), skip.end(), mod) != skip.end()) continue;
+
+        if (subs != subscriptions.end()) {
+            auto filter = std::find_if(subs->filters.begin(), subs->filters.end(), [&](const auto& f) { return f.mod == mod; });
+            if (filter != subs->filters.end()) {
+                if (filter->async && enqueue_events(*filter, hook, ops)) continue;
+                if (std::none_of(ops.begin(), ops.end(), [&](const auto& op) {
+                    return filter->matches(op.from, op.to, op.quantity.amount, op.memo);
+                })) continue;
+            }
+        }
+
+        require_recipient(mod);
+    }
+}
+
+bool totemtoken::enqueue_events(const totems::HookFilter& filter, const name& hook, const std::vector<rules::Operation>& ops) {
+	async_queues_table queues(get_self(), get_self().value);
+	auto queue = queues.find(filter.mod.value);
+	const uint64_t next_id = queue == queues.end() ? 0 : queue->next_id;
+	const uint64_t head = queue == queues.end() ? 0 : queue->head;
+
+	uint64_t matched = 0;
+	for (const auto& op : ops) {
+		if (filter.matches(op.from, op.to, op.quantity.amount, op.memo)) matched++;
+	}
+	if (matched == 0) return true;
+	// a backed up mod is notified synchronously instead of losing events
+	if (next_id - head + matched > totems::MAX_QUEUED_EVENTS) return false;
+
+	// queue rows are freed by `crank`, so the contract pays for them
+	hook_queue_table events(get_self(), filter.mod.value);
+	uint64_t id = next_id;
+	for (const auto& op : ops) {
+		if (!filter.matches(op.from, op.to, op.quantity.amount, op.memo)) continue;
+		events.emplace(get_self(), [&](auto& row) {
+			row.id = id++;
+			row.hook = hook;
+			row.from = op.from;
+			row.to = op.to;
+			row.quantity = op.quantity;
+			row.memo = op.memo.substr(0, totems::MAX_QUEUED_MEMO);
+		});
+	}
+
+	if (queue == queues.end()) {
+		queues.emplace(get_self(), [&](auto& row) {
+			row.mod = filter.mod;
+			row.next_id = id;
+			row.head = 0;
+		});
+	} else {
+		queues.modify(queue, same_payer, [&](auto& row) {
+			row.next_id = id;
+		});
+	}
+	return true;
+}
+
+void totemtoken::crank(const name& mod, const uint32_t& max_events) {
+	check(max_events <= MAX_CRANK_EVENTS, "Too many events in one crank");
+	const auto batch = pop_events(mod, max_events);
+
+	action(
+		permission_level{get_self(), "active"_n},
+		get_self(),
+		"deliver"_n,
+		std::make_tuple(mod, batch)
+	).send();
+}
+
+void totemtoken::deliver(const name& mod, const std::vector<totems::HookEvent>& events) {
+	require_auth(get_self());
+	require_recipient(mod);
+}
+
+void totemtoken::skipevents(const name& mod, const uint32_t& max_events) {
+	require_auth(mod);
+	check(max_events <= MAX_CRANK_EVENTS, "Too many events to skip");
+	pop_events(mod, max_events);
+}
+
+std::vector<totems::HookEvent> totemtoken::pop_events(const name& mod, const uint32_t& max_events) {
+	check(max_events > 0, "max_events must be positive");
+
+	async_queues_table queues(get_self(), get_self().value);
+	auto queue = queues.find(mod.value);
+	check(queue != queues.end() && queue->head < queue->next_id, "No events to deliver");
+
+	hook_queue_table events(get_self(), mod.value);
+	std::vector<totems::HookEvent> batch;
+	for (auto it = events.begin(); it != events.end() && batch.size() < max_events;) {
+		batch.push_back(*it);
+		it = events.erase(it);
+	}
+
+	queues.modify(queue, same_payer, [&](auto& row) {
+		row.head = batch.back().id + 1;
+	});
+	return batch;
+}
+
+void totemtoken::subscribe(const symbol_code& ticker, const name& hook, const totems::HookFilter& filter) {
+	require_auth(filter.mod);
+
+	const auto hook_id = totems::find_hook(hook);
+	check(hook_id.has_value(), "Unsupported hook: " + hook.to_string());
+
+	totems_table totems(get_self(), get_self().value);
+	const auto& totem = totems.get(ticker.raw(), "Totem not found");
+	const auto& mods = totem.mods[hook_id.value()];
+	check(std::find(mods.begin(), mods.end(), filter.mod) != mods.end(), "Mod is not used by this totem on this hook");
+
+	check(filter.accounts.size() <= totems::MAX_FILTER_ACCOUNTS, "Too many filter accounts");
+	check(filter.direction <= totems::FILTER_TO, "Invalid filter direction");
+	check(filter.min_amount >= 0, "Filter minimum amount cannot be negative");
+	check(filter.memo_prefix.size() <= totems::MAX_FILTER_MEMO_PREFIX, "Filter memo prefix too long");
+
+	// filters are bounded by the mods on the hook, so the contract pays for the shared row
+	hook_subscriptions_table subscriptions(get_self(), ticker.raw());
+	auto subs = subscriptions.find(hook.value);
+	if (subs == subscriptions.end()) {
+		subscriptions.emplace(get_self(), [&](auto& row) {
+			row.hook = hook;
+			row.filters.push_back(filter);
+		});
+		return;
+	}
+
+	subscriptions.modify(subs, same_payer, [&](auto& row) {
+		auto existing = std::find_if(row.filters.begin(), row.filters.end(), [&](const auto& f) { return f.mod == filter.mod; });
+		if (existing == row.filters.end()) row.filters.push_back(filter);
+		else *existing = filter;
+	});
+}
+
+void totemtoken::unsubscribe(const name& mod, const symbol_code& ticker, const name& hook) {
+	require_auth(mod);
+
+	hook_subscriptions_table subscriptions(get_self(), ticker.raw());
+	const auto& subs = subscriptions.get(hook.value, "Mod is not subscribed");
+	auto filter = std::find_if(subs.filters.begin(), subs.filters.end(), [&](const auto& f) { return f.mod == mod; });
+	check(filter != subs.filters.end(), "Mod is not subscribed");
+
+	if (subs.filters.size() == 1) {
+		subscriptions.erase(subs);
+		return;
+	}
+
+	const auto index = std::distance(subs.filters.begin(), filter);
+	subscriptions.modify(subs, same_payer, [&](auto& row) {
+		row.filters.erase(row.filters.begin() + index);
+	});
+}
+
+void totemtoken::save_hook_plan(
+	const symbol_code& ticker,
+	const name& hook,
+	const std::vector<totems::PlanAction>& plan,
+	const std::vector<totems::ModRule>& rules,
+	const name& ram_payer
+) {
+	// hooks without required actions or rules don't need a row, a missing plan means nothing to verify
+	if(plan.empty() && rules.empty()) return;
+
+	hookplans_table hookplans(get_self(), ticker.raw());
+	hookplans.emplace(ram_payer, [&](auto& row) {
+		row.hook = hook;
+		row.actions = plan;
+		if(!rules.empty()) row.rules = rules;
+	});
+}
+
+std::vector<name> totemtoken::verify_hook(const name& sender, const symbol_code& ticker, const name& hook, const std::vector<rules::Operation>& ops) {
+	hookplans_table hookplans(get_self(), ticker.raw());
+	auto plan = hookplans.find(hook.value);
+	if(plan == hookplans.end()) return {};
+
+	// rules depend on the operation, so unlike required actions they run every time
+	std::vector<name> ruled;
+	if(plan->rules.has_value()){
+		for(const auto& rule : plan->rules.value()){
+			for(const auto& op : ops){
+				check(
+					rules::run(rule.program, [&](const rules::Field& field) { return rule_field(op, field); }),
+					"Rejected by rule mod: " + rule.mod.to_string()
+				);
+			}
+			ruled.push_back(rule.mod);
+		}
+	}
+	if(plan->actions.empty()) return ruled;
+
+	// not memoized across the actions of a transaction: reading and hashing the transaction to key a memo
+	// costs more than the scan it would skip, the scan reads the same actions and stops once everything matched
+	action_verifier::verify(sender, ticker, plan->actions);
+	return ruled;
+}
+
+int64_t totemtoken::rule_field(const rules::Operation& op, const rules::Field& field) {
+	auto balance_of = [&](const name& owner) -> int64_t {
+		if(owner == name()) return 0;
+		balances_table balances(get_self(), owner.value);
+		auto balance = balances.find(op.quantity.symbol.code().raw());
+		return balance == balances.end() ? 0 : balance->balance.amount;
+	};
+
+	switch(field){
+		case rules::Field::FROM: return static_cast<int64_t>(op.from.value);
+		case rules::Field::TO: return static_cast<int64_t>(op.to.value);
+		case rules::Field::AMOUNT: return op.quantity.amount;
+		case rules::Field::FROM_BALANCE: return balance_of(op.from);
+		case rules::Field::TO_BALANCE: return balance_of(op.to);
+		case rules::Field::SUPPLY: return op.supply.amount;
+		case rules::Field::MAX_SUPPLY: return op.max_supply.amount;
+		case rules::Field::NOW: return current_time_point().sec_since_epoch();
+	}
+	check(false, "Unknown rule field");
+	return 0;
+}
+
+checksum256 totemtoken::transaction_id() {
+	std::vector<char> packed(transaction_size());
+	read_transaction(packed.data(), packed.size());
+	return sha256(packed.data(), packed.size());
+}
+
+void totemtoken::add_licenses(const symbol_code& ticker, const std::vector<name>& mods, const name& ram_payer) {
+	if(mods.empty()) return;
+
+	std::vector<name> sorted = mods;
+	std::sort(sorted.begin(), sorted.end());
+	sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+	license_set_table licenses(get_self(), get_self().value);
+	auto it = licenses.find(ticker.raw());
+	if(it == licenses.end()) {
+		licenses.emplace(ram_payer, [&](auto& row) {
+			row.ticker = ticker;
+			row.mods = sorted;
+		});
+		return;
+	}
+
+	licenses.modify(it, same_payer, [&](auto& row) {
+		std::vector<name> merged;
+		merged.reserve(row.mods.size() + sorted.size());
+		std::set_union(row.mods.begin(), row.mods.end(), sorted.begin(), sorted.end(), std::back_inserter(merged));
+		row.mods = std::move(merged);
+	});
+}
+
+void totemtoken::syncminters(const std::vector<symbol_code>& tickers) {
+	require_auth(get_self());
+
+	totem_meta_table metas(get_self(), get_self().value);
+	for(const auto& ticker : tickers){
+		const auto& meta = metas.get(ticker.raw(), "Totem not found");
+		minters_table minters(get_self(), ticker.raw());
+		for(const auto& alloc : meta.allocations){
+			if(!alloc.is_minter.has_value() || !alloc.is_minter.value()) continue;
+			if(minters.find(alloc.recipient.value) != minters.end()) continue;
+
+			minters.emplace(get_self(), [&](auto& row) {
+				row.mod = alloc.recipient;
+			});
+		}
+	}
+}
+
+void totemtoken::addlicenses(const symbol_code& ticker, const std::vector<name>& mods) {
+	require_auth(totems::MARKET_CONTRACT);
+
+	totems_table totems(get_self(), get_self().value);
+	check(totems.find(ticker.raw()) != totems.end(), "Totem not found");
+
+	add_licenses(ticker, mods, get_self());
+}
+
+void totemtoken::migratelics(const std::vector<symbol_code>& tickers) {
+	require_auth(get_self());
+
+	for(const auto& ticker : tickers){
+		legacy_license_table legacy(get_self(), ticker.raw());
+		std::vector<name> mods;
+		for(auto it = legacy.begin(); it != legacy.end();){
+			mods.push_back(it->mod);
+			it = legacy.erase(it);
+		}
+
+		add_licenses(ticker, mods, get_self());
+	}
+}
+
+void totemtoken::record_mod_usage(const symbol_code& ticker, const name& mod, const uint8_t& hooks, const name& ram_payer) {
+	mod_usage_table usages(get_self(), mod.value);
+	usages.emplace(ram_payer, [&](auto& row) {
+		row.ticker = ticker;
+		row.hooks = hooks;
+	});
+
+	mod_counts_table counts(get_self(), get_self().value);
+	auto count = counts.find(mod.value);
+	if(count == counts.end()) {
+		counts.emplace(ram_payer, [&](auto& row) {
+			row.mod = mod;
+			row.totems = 1;
+		});
+	} else {
+		counts.modify(count, same_payer, [&](auto& row) {
+			row.totems += 1;
+		});
+	}
+}
+
+void totemtoken::syncusage(const std::vector<symbol_code>& tickers) {
+	require_auth(get_self());
+
+	totems_table totems(get_self(), get_self().value);
+	for(const auto& ticker : tickers){
+		const auto& totem = totems.get(ticker.raw(), "Totem not found");
+
+		std::map<name, uint8_t> mod_hooks;
+		for(const auto& hook : totems::ALL_HOOKS){
+			for(const auto& mod : totem.mods[hook]) mod_hooks[mod] |= totems::hook_bit(hook);
+		}
+
+		for(const auto& [mod, hooks] : mod_hooks){
+			mod_usage_table usages(get_self(), mod.value);
+			if(usages.find(ticker.raw()) != usages.end()) continue;
+			record_mod_usage(ticker, mod, hooks, get_self());
+		}
+	}
+}
+
+void totemtoken::syncholders(const symbol_code& ticker, const std::vector<name>& owners) {
+	require_auth(get_self());
+
+	holders_table holders(get_self(), ticker.raw());
+	for(const auto& owner : owners){
+		balances_table balances(get_self(), owner.value);
+		auto balance = balances.find(ticker.raw());
+		if(balance != balances.end()){
+			set_holder(owner, ticker, balance->balance.amount, get_self());
+			continue;
+		}
+
+		auto holder = holders.find(owner.value);
+		if(holder != holders.end()){
+			holders.erase(holder);
+		}
+	}
+}
+
+void totemtoken::reindexstats(const std::vector<symbol_code>& tickers) {
+	require_auth(get_self());
+
+	for(const auto& ticker : tickers){
+		reindex_stats(ticker);
+	}
+}
+
+void totemtoken::reindex_stats(const symbol_code& ticker) {
+	unindexed_totemstats_table unindexed(get_self(), get_self().value);
+	totemstats_table totemstats(get_self(), get_self().value);
+	auto by_holders = totemstats.get_index<"byholders"_n>();
+
+	const auto& row = unindexed.get(ticker.raw(), "Totem stats not found");
+	if(by_holders.find(row.by_holders()) != by_holders.end()) return;
+
+	// rows without secondary entries have to be re-inserted, modifying them would fail to find their index entries
+	const totems::TotemStats stats = row;
+	unindexed.erase(row);
+	totemstats.emplace(get_self(), [&](auto& r) {
+		r = stats;
+	});
+}
+
+void totemtoken::migrate(const uint32_t& max_rows, const std::optional<symbol_code>& cursor) {
+	require_auth(get_self());
+
+	legacy_totems_table legacy_totems(get_self(), get_self().value);
+	totems_table totems(get_self(), get_self().value);
+	totem_meta_table metas(get_self(), get_self().value);
+
+	// legacy rows are kept for mods built against the old library, so already migrated rows are skipped
+	uint32_t count = 0;
+	auto legacy_itr = cursor.has_value() ? legacy_totems.upper_bound(cursor.value().raw()) : legacy_totems.begin();
+	for(; legacy_itr != legacy_totems.end() && count < max_rows; ++legacy_itr, ++count){
+		if(totems.find(legacy_itr->primary_key()) != totems.end()) continue;
+
+		const auto& totem = *totems.emplace(get_self(), [&](auto& row) {
+			row.creator = legacy_itr->creator;
+			row.supply = legacy_itr->supply;
+			row.max_supply = legacy_itr->max_supply;
+			row.mods = legacy_itr->mods;
+		});
+		// hooked actions only verify what is in a plan, so a totem can't be used before its plans exist
+		compile_plans(totem, get_self());
+		// and its stats row has to be in the ranking indices before anything modifies it
+		reindex_stats(totem.max_supply.symbol.code());
+
+		metas.emplace(get_self(), [&](auto& row) {
+			row.ticker = legacy_itr->max_supply.symbol;
+			row.allocations = legacy_itr->allocations;
+			row.allocation_count = legacy_itr->allocations.size();
+			row.details = legacy_itr->details;
+			row.created_at = legacy_itr->created_at;
+			row.updated_at = legacy_itr->updated_at;
+		});
+	}
+}
+
+void totemtoken::droplegacy(const uint32_t& max_rows) {
+	require_auth(get_self());
+
+	legacy_totems_table legacy_totems(get_self(), get_self().value);
+	totems_table totems(get_self(), get_self().value);
+
+	uint32_t count = 0;
+	auto legacy_itr = legacy_totems.begin();
+	while(legacy_itr != legacy_totems.end() && count < max_rows){
+		check(totems.find(legacy_itr->primary_key()) != totems.end(), "Legacy totem is not migrated yet");
+		legacy_itr = legacy_totems.erase(legacy_itr);
+		++count;
+	}
+}
+
+void totemtoken::compileplans(const symbol_code& ticker) {
+	totems_table totems(get_self(), get_self().value);
+	const auto& totem = totems.get(ticker.raw(), "Totem not found");
+	if(!has_auth(get_self())) require_auth(totem.creator);
+
+	// the creator pays for the plans they recompile
+	compile_plans(totem, has_auth(get_self()) ? get_self() : totem.creator);
+}
+
+void totemtoken::compile_plans(const totems::Totem& totem, const name& ram_payer) {
+	const auto ticker = totem.max_supply.symbol.code();
+	hookplans_table hookplans(get_self(), ticker.raw());
+	auto plan_itr = hookplans.begin();
+	while(plan_itr != hookplans.end()){
+		plan_itr = hookplans.erase(plan_itr);
+	}
+
+	for (const auto& hook : totems::ALL_HOOKS) {
+		const name hook_name = totems::hook_name(hook);
+		std::vector<totems::PlanAction> plan;
+		std::vector<totems::ModRule> hook_rules;
+		for (const auto& mod_name : totem.mods[hook]) {
+			auto mod = totems::get_mod(mod_name);
+			check(mod.has_value(), "Mod is not published in market: " + mod_name.to_string());
+			totems::merge_into_plan(plan, mod.value(), hook_name);
+			if(mod.value().rule.has_value() && !mod.value().rule.value().empty()){
+				hook_rules.push_back(totems::ModRule{ .mod = mod_name, .program = mod.value().rule.value() });
+			}
+		}
+		save_hook_plan(ticker, hook_name, plan, hook_rules, ram_payer);
+	}
+}
+
+
+// READ ONLY
+uint64_t totemtoken::getfee(const std::vector<name> mods){
+	uint64_t mod_fees = 0;
+	for (const auto& mod_name : mods) {
+        auto mod = totems::get_mod_index(mod_name);
+        check(mod.has_value(), "Mod is not published in market");
+        mod_fees += mod.value().price;
+    }
+
+    return mod_fees + shared::get_base_fee(get_self());
+}
+
+totemtoken::GetTotemsResult totemtoken::gettotems(const std::vector<symbol_code>& tickers){
+	totems_table totems(get_self(), get_self().value);
+	totem_meta_table metas(get_self(), get_self().value);
+	GetTotemsResult result;
+
+	totemstats_table totemstats(get_self(), get_self().value);
+	for(const auto& code : tickers){
+		auto totem_itr = totems.find(code.raw());
+		if(totem_itr != totems.end()){
+			auto stats = totemstats.find(totem_itr->max_supply.symbol.code().raw());
+            result.results.push_back(TotemAndStats{
+                .totem = *totem_itr,
+                .meta = metas.get(code.raw()),
+                .stats = *stats
+            });
+		}
+	}
+	return result;
+}
+
+totemtoken::GetTotemsResult totemtoken::listtotems(const uint32_t& per_page, const std::optional<uint64_t>& cursor, const uint32_t& max_bytes){
+	totems_table totems(get_self(), get_self().value);
+	totem_meta_table metas(get_self(), get_self().value);
+	GetTotemsResult result;
+
+	// the cursor is exclusive, and still works if the cursor totem is gone
+	auto totem_itr = cursor.has_value() ? totems.upper_bound(cursor.value()) : totems.begin();
+
+	uint32_t count = 0;
+	shared::ResponseBudget budget{max_bytes};
+	totemstats_table totemstats(get_self(), get_self().value);
+	while(totem_itr != totems.end() && count < per_page){
+		const auto code = totem_itr->max_supply.symbol.code().raw();
+		TotemAndStats row{
+			.totem = *totem_itr,
+			.meta = metas.get(code),
+			.stats = totemstats.get(code)
+		};
+		if(!budget.fits(row)) break;
+
+		result.results.push_back(row);
+		result.cursor = code;
+		++totem_itr;
+		++count;
+	}
+
+	result.has_more = totem_itr != totems.end();
 	return result;
 }
 
-totemtoken::GetBalancesResult totemtoken::getbalances(const std::vector<name>& accounts, const std::vector<symbol_code>& tickers){
-	GetBalancesResult result;
+totemtoken::TotemCard totemtoken::make_card(const totems::Totem& totem, const totems::TotemMeta& meta, const totems::TotemStats& stats){
+	return TotemCard{
+		.ticker = totem.max_supply.symbol,
+		.title = meta.details.name,
+		.image = meta.details.image,
+		.creator = totem.creator,
+		.supply = totem.supply,
+		.max_supply = totem.max_supply,
+		.holders = stats.holders
+	};
+}
+
+totemtoken::GetTotemCardsResult totemtoken::totemcards(const std::vector<symbol_code>& tickers){
+	totems_table totems(get_self(), get_self().value);
+	totem_meta_table metas(get_self(), get_self().value);
+	totemstats_table totemstats(get_self(), get_self().value);
+	GetTotemCardsResult result;
+
+	for(const auto& code : tickers){
+		auto totem_itr = totems.find(code.raw());
+		if(totem_itr != totems.end()){
+			result.cards.push_back(make_card(*totem_itr, metas.get(code.raw()), totemstats.get(code.raw())));
+		}
+	}
+	return result;
+}
+
+totemtoken::GetTotemCardsResult totemtoken::listcards(const uint32_t& per_page, const std::optional<uint64_t>& cursor, const uint32_t& max_bytes){
+	totems_table totems(get_self(), get_self().value);
+	totem_meta_table metas(get_self(), get_self().value);
+	totemstats_table totemstats(get_self(), get_self().value);
+	GetTotemCardsResult result;
+
+	auto totem_itr = cursor.has_value() ? totems.upper_bound(cursor.value()) : totems.begin();
+
+	uint32_t count = 0;
+	shared::ResponseBudget budget{max_bytes};
+	while(totem_itr != totems.end() && count < per_page){
+		const auto code = totem_itr->max_supply.symbol.code().raw();
+		auto card = make_card(*totem_itr, metas.get(code), totemstats.get(code));
+		if(!budget.fits(card)) break;
+
+		result.cards.push_back(card);
+		result.cursor = code;
+		++totem_itr;
+		++count;
+	}
+
+	result.has_more = totem_itr != totems.end();
+	return result;
+}
+
+bool totemtoken::matches(const TotemQuery& query, const totems::Totem& totem, const totems::TotemStats& stats){
+	if(query.creator.has_value() && totem.creator != query.creator.value()) return false;
+
+	if(query.uses_mod.has_value() || query.hook.has_value()){
+		bool found = false;
+		for(const auto& hook : totems::ALL_HOOKS){
+			if(query.hook.has_value() && totems::hook_name(hook) != query.hook.value()) continue;
+
+			const auto& mods = totem.mods[hook];
+			found = query.uses_mod.has_value()
+				? std::find(mods.begin(), mods.end(), query.uses_mod.value()) != mods.end()
+				: !mods.empty();
+			if(found) break;
+		}
+		if(!found) return false;
+	}
+
+	return stats.holders >= query.min_holders
+		&& stats.transfers >= query.min_transfers
+		&& stats.mints >= query.min_mints;
+}
+
+totemtoken::GetTotemCardsResult totemtoken::querytotems(
+	const TotemQuery& query,
+	const uint32_t& per_page,
+	const std::optional<uint64_t>& cursor,
+	const uint32_t& max_rows,
+	const uint32_t& max_bytes
+){
+	totems_table totems(get_self(), get_self().value);
+	totem_meta_table metas(get_self(), get_self().value);
+	totemstats_table totemstats(get_self(), get_self().value);
+	GetTotemCardsResult result;
+
+	uint32_t count = 0;
+	uint32_t scanned = 0;
+	shared::ResponseBudget budget{max_bytes};
+
+	// returns false when the page is full and `totem` has to be scanned again on the next page
+	auto scan = [&](const totems::Totem& totem) {
+		const auto code = totem.max_supply.symbol.code().raw();
+		const auto& stats = totemstats.get(code);
+		if(matches(query, totem, stats)){
+			auto card = make_card(totem, metas.get(code), stats);
+			if(!budget.fits(card)) return false;
+			result.cards.push_back(card);
+			++count;
+		}
+
+		// the cursor follows the scan, not the matches, so that the next page doesn't rescan
+		result.cursor = code;
+		++scanned;
+		return true;
+	};
+	auto has_room = [&]() {
+		return count < per_page && (max_rows == 0 || scanned < max_rows);
+	};
+
+	if(query.creator.has_value()){
+		// a creator only needs its own range of the creator index
+		auto by_creator = totems.get_index<"bycreator"_n>();
+		const uint128_t creator_key = static_cast<uint128_t>(query.creator.value().value) << 64;
+		auto totem_itr = cursor.has_value()
+			? by_creator.upper_bound(creator_key | cursor.value())
+			: by_creator.lower_bound(creator_key);
+
+		while(totem_itr != by_creator.end() && totem_itr->creator == query.creator.value() && has_room()){
+			if(!scan(*totem_itr)) break;
+			++totem_itr;
+		}
+
+		result.has_more = totem_itr != by_creator.end() && totem_itr->creator == query.creator.value();
+		return result;
+	}
+
+	auto totem_itr = cursor.has_value() ? totems.upper_bound(cursor.value()) : totems.begin();
+	while(totem_itr != totems.end() && has_room()){
+		if(!scan(*totem_itr)) break;
+		++totem_itr;
+	}
+
+	result.has_more = totem_itr != totems.end();
+	return result;
+}
+
+totemtoken::GetTotemsResult totemtoken::listcreator(const name& creator, const uint32_t& per_page, const std::optional<uint64_t>& cursor, const uint32_t& max_bytes){
+	totems_table totems(get_self(), get_self().value);
+	totem_meta_table metas(get_self(), get_self().value);
+	totemstats_table totemstats(get_self(), get_self().value);
+	GetTotemsResult result;
+
+	auto by_creator = totems.get_index<"bycreator"_n>();
+	const uint128_t creator_key = static_cast<uint128_t>(creator.value) << 64;
+	auto totem_itr = cursor.has_value()
+		? by_creator.upper_bound(creator_key | cursor.value())
+		: by_creator.lower_bound(creator_key);
+
+	uint32_t count = 0;
+	shared::ResponseBudget budget{max_bytes};
+	while(totem_itr != by_creator.end() && totem_itr->creator == creator && count < per_page){
+		const auto code = totem_itr->max_supply.symbol.code().raw();
+		TotemAndStats row{
+			.totem = *totem_itr,
+			.meta = metas.get(code),
+			.stats = totemstats.get(code)
+		};
+		if(!budget.fits(row)) break;
+
+		result.results.push_back(row);
+		result.cursor = code;
+		++totem_itr;
+		++count;
+	}
+
+	result.has_more = totem_itr != by_creator.end() && totem_itr->creator == creator;
+	return result;
+}
+
+totemtoken::GetRecentTotemsResult totemtoken::listrecent(const uint32_t& per_page, const std::optional<uint128_t>& cursor, const uint32_t& max_bytes){
+	totems_table totems(get_self(), get_self().value);
+	totem_meta_table metas(get_self(), get_self().value);
+	totemstats_table totemstats(get_self(), get_self().value);
+	GetRecentTotemsResult result{ .results = {}, .cursor = cursor.value_or(0), .has_more = false };
+
+	// walks down from the newest, the cursor is exclusive and still works if the cursor totem is gone
+	auto by_created = metas.get_index<"bycreated"_n>();
+	auto meta_itr = cursor.has_value() ? by_created.lower_bound(cursor.value()) : by_created.end();
+
+	uint32_t count = 0;
+	shared::ResponseBudget budget{max_bytes};
+	while(meta_itr != by_created.begin() && count < per_page){
+		auto next = meta_itr;
+		--next;
+		const auto code = next->ticker.code().raw();
+		TotemAndStats row{
+			.totem = totems.get(code),
+			.meta = *next,
+			.stats = totemstats.get(code)
+		};
+		if(!budget.fits(row)) break;
+
+		result.results.push_back(row);
+		result.cursor = next->by_created();
+		meta_itr = next;
+		++count;
+	}
+
+	result.has_more = meta_itr != by_created.begin();
+	return result;
+}
+
+totemtoken::GetBalancesResult totemtoken::getbalances(
+	const std::vector<name>& accounts,
+	const std::vector<symbol_code>& tickers,
+	const uint32_t& per_page,
+	const std::optional<BalancesCursor>& cursor,
+	const uint32_t& max_bytes
+){
+	GetBalancesResult result{ .balances = {}, .cursor = {}, .has_more = false };
+	if(cursor.has_value()) result.cursor = cursor.value();
+
+	// balances are walked in (account, ticker) order so that the cursor can resume anywhere
+	std::vector<name> sorted_accounts = accounts;
+	std::sort(sorted_accounts.begin(), sorted_accounts.end());
+	sorted_accounts.erase(std::unique(sorted_accounts.begin(), sorted_accounts.end()), sorted_accounts.end());
+
+	std::vector<symbol_code> sorted_tickers = tickers;
+	std::sort(sorted_tickers.begin(), sorted_tickers.end(), [](const symbol_code& a, const symbol_code& b) {
+		return a.raw() < b.raw();
+	});
+	sorted_tickers.erase(std::unique(sorted_tickers.begin(), sorted_tickers.end()), sorted_tickers.end());
+
+	shared::ResponseBudget budget{max_bytes};
+	auto take = [&](const name& account, const asset& balance) {
+		AccountBalance row{
+			.account = account,
+			.balance = balance
+		};
+		// there is at least this row left, so a full page has more
+		if(result.balances.size() >= per_page || !budget.fits(row)) {
+			result.has_more = true;
+			return false;
+		}
+
+		result.balances.push_back(row);
+		result.cursor = BalancesCursor{
+			.account = account,
+			.ticker = balance.symbol.code()
+		};
+		return true;
+	};
+
+	auto account_itr = cursor.has_value()
+		? std::lower_bound(sorted_accounts.begin(), sorted_accounts.end(), cursor->account)
+		: sorted_accounts.begin();
+
+	for(; account_itr != sorted_accounts.end(); ++account_itr){
+		const auto& account = *account_itr;
+		// only the cursor's own account resumes after a ticker, later accounts start from the beginning
+		const bool resuming = cursor.has_value() && cursor->account == account;
 
-	for(const auto& account : accounts){
 		balances_table balances(get_self(), account.value);
-		if(tickers.size() == 0){
-            auto bal_iter = balances.begin();
+		if(sorted_tickers.size() == 0){
+            auto bal_iter = resuming ? balances.upper_bound(cursor->ticker.raw()) : balances.begin();
             while(bal_iter != balances.end()){
-                result.balances.push_back(AccountBalance{
-                    .account = account,
-                    .balance = bal_iter->balance
-                });
+                if(!take(account, bal_iter->balance)) return result;
                 ++bal_iter;
             }
         } else {
-            for(const auto& code : tickers){
+            for(const auto& code : sorted_tickers){
+                if(resuming && code.raw() <= cursor->ticker.raw()) continue;
+
                 auto it = balances.find(code.raw());
                 if(it != balances.end()){
-                    result.balances.push_back(AccountBalance{
-                        .account = account,
-                        .balance = it->balance
-                    });
+                    if(!take(account, it->balance)) return result;
                 }
             }
         }
 	}
 
 	return result;
-}
\ No newline at end of file
+}
+
+totemtoken::GetHoldersResult totemtoken::getholders(const symbol_code& ticker, const std::optional<name>& cursor, const uint32_t& per_page, const uint32_t& max_bytes){
+	holders_table holders(get_self(), ticker.raw());
+	GetHoldersResult result;
+
+	auto holder_itr = holders.begin();
+	if(cursor.has_value()){
+		holder_itr = holders.upper_bound(cursor.value().value);
+	}
+
+	uint32_t count = 0;
+	shared::ResponseBudget budget{max_bytes};
+	while(holder_itr != holders.end() && count < per_page){
+		if(!budget.fits(*holder_itr)) break;
+
+		result.holders.push_back(*holder_itr);
+		result.cursor = holder_itr->owner;
+		++holder_itr;
+		++count;
+	}
+
+	result.has_more = holder_itr != holders.end();
+	return result;
+}
+
+std::vector<totems::Holder> totemtoken::topholders(const symbol_code& ticker, const uint32_t& n){
+	check(n <= MAX_TOP_HOLDERS, "Too many top holders");
+
+	holders_table holders(get_self(), ticker.raw());
+	auto by_balance = holders.get_index<"bybalance"_n>();
+	std::vector<totems::Holder> result;
+
+	for(auto it = by_balance.rbegin(); it != by_balance.rend() && result.size() < n; ++it){
+		result.push_back(*it);
+	}
+
+	return result;
+}
+
+totemtoken::GetEventsResult totemtoken::events(const uint64_t& since_seq, const uint32_t& max){
+	check(max <= MAX_EVENTS_PAGE, "Too many events in one page");
+
+	journal_state_table state(get_self(), get_self().value);
+	const auto last = state.get_or_default().last_seq;
+	journal_table journal(get_self(), get_self().value);
+
+	// older events were overwritten by newer ones
+	const uint64_t oldest = last > totems::JOURNAL_SIZE ? last - totems::JOURNAL_SIZE + 1 : 1;
+	GetEventsResult result{ .events = {}, .cursor = since_seq, .has_more = false, .oldest_seq = oldest, .gap = since_seq + 1 < oldest };
+	uint64_t seq = std::max(since_seq + 1, oldest);
+	for(; seq <= last && result.events.size() < max; ++seq){
+		result.events.push_back(journal.get(seq % totems::JOURNAL_SIZE, "Journal event not found"));
+		result.cursor = seq;
+	}
+
+	result.has_more = seq <= last;
+	return result;
+}
+
+totemtoken::RankTotemsResult totemtoken::ranktotems(const name& metric, const uint32_t& per_page, const std::optional<uint128_t>& cursor, const uint32_t& max_bytes){
+	totemstats_table totemstats(get_self(), get_self().value);
+	RankTotemsResult result;
+
+	auto rank = [&](const auto& index, uint128_t (totems::TotemStats::*key)() const) {
+		// walks down from the highest key, the cursor is exclusive
+		auto it = cursor.has_value() ? index.lower_bound(cursor.value()) : index.end();
+
+		uint32_t count = 0;
+		shared::ResponseBudget budget{max_bytes};
+		while(it != index.begin() && count < per_page){
+			auto next = it;
+			--next;
+			if(!budget.fits(*next)) break;
+
+			result.results.push_back(*next);
+			result.cursor = ((*next).*key)();
+			it = next;
+			++count;
+		}
+
+		result.has_more = it != index.begin();
+	};
+
+	if(metric == "holders"_n) rank(totemstats.get_index<"byholders"_n>(), &totems::TotemStats::by_holders);
+	else if(metric == "transfers"_n) rank(totemstats.get_index<"bytransfers"_n>(), &totems::TotemStats::by_transfers);
+	else if(metric == "mints"_n) rank(totemstats.get_index<"bymints"_n>(), &totems::TotemStats::by_mints);
+	else check(false, "Unsupported metric: " + metric.to_string());
+
+	return result;
+}
+
+totemtoken::TotemsByModResult totemtoken::totemsbymod(const name& mod, const std::optional<uint64_t>& cursor, const uint32_t& per_page, const uint32_t& max_bytes){
+	mod_usage_table usages(get_self(), mod.value);
+	TotemsByModResult result;
+
+	auto usage_itr = cursor.has_value() ? usages.upper_bound(cursor.value()) : usages.begin();
+
+	uint32_t count = 0;
+	shared::ResponseBudget budget{max_bytes};
+	while(usage_itr != usages.end() && count < per_page){
+		if(!budget.fits(*usage_itr)) break;
+
+		result.usages.push_back(*usage_itr);
+		result.cursor = usage_itr->ticker.raw();
+		++usage_itr;
+		++count;
+	}
+
+	result.has_more = usage_itr != usages.end();
+	return result;
+}
@@ -20,6 +20,7 @@ const ALLOWED_ACTIONS = new Set([
     "mint",
     "burn",
     "transfer",
+    "transfermany",
     "open",
     "close",
 ]);
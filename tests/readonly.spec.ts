@@ -82,7 +82,7 @@ describe('Readonly Actions', () => {
     })
 
     it('should be able to list mods', async () => {
-        const firstBatch = await market.actions.listmods([5, null]).send().then(x => {
+        const firstBatch = await market.actions.listmods([5, null, 0]).send().then(x => {
             return JSON.parse(JSON.stringify(x[0].returnValue));
         });
         assert.equal(firstBatch.mods.length, 5, `Should return 5 mods`);
@@ -92,7 +92,7 @@ describe('Readonly Actions', () => {
             validateMod(mod, expectedMod);
         }
 
-        const secondBatch = await market.actions.listmods([5, firstBatch.cursor]).send().then(x => {
+        const secondBatch = await market.actions.listmods([5, firstBatch.cursor, 0]).send().then(x => {
             return JSON.parse(JSON.stringify(x[0].returnValue));
         });
 
@@ -106,7 +106,7 @@ describe('Readonly Actions', () => {
     })
 
     it('should be able to get totems by tickers', async () => {
-        const firstBatch = await market.actions.listmods([5, null]).send().then(x => {
+        const firstBatch = await market.actions.listmods([5, null, 0]).send().then(x => {
             return JSON.parse(JSON.stringify(x[0].returnValue));
         });
         assert.equal(firstBatch.mods.length, 5, `Should return 5 mods`);
@@ -116,7 +116,7 @@ describe('Readonly Actions', () => {
             validateMod(mod, expectedMod);
         }
 
-        const secondBatch = await market.actions.listmods([5, firstBatch.cursor]).send().then(x => {
+        const secondBatch = await market.actions.listmods([5, firstBatch.cursor, 0]).send().then(x => {
             return JSON.parse(JSON.stringify(x[0].returnValue));
         });
 
@@ -136,16 +136,17 @@ describe('Readonly Actions', () => {
             });
             const parsedTicker = result.results[0].totem.max_supply.split(' ')[1];
             const decimals = parseInt(result.results[0].totem.max_supply.split('.')[1].split(' ')[0].length);
-            const totemRows = totemsContract.tables.totems().getTableRows();
+            const totemRows = totemsContract.tables.totemcore().getTableRows();
             const expectedTotem = totemRows.find((t:any) => t.max_supply === result.results[0].totem.max_supply);
+            const expectedMeta = totemsContract.tables.totemmeta().getTableRows().find((m:any) => m.ticker === result.results[0].meta.ticker);
             assert.equal(result.results.length, 1, `Should return 1 totem for ticker ${ticker}`);
             assert.equal(parsedTicker, ticker, `Totem ticker should be ${ticker}`);
             assert.equal(decimals, 4, `Totem decimals should be 4`);
             assert.equal(result.results[0].totem.creator, expectedTotem.creator, `Totem creator should be ${expectedTotem.creator}`);
             assert.equal(result.results[0].totem.max_supply, expectedTotem.max_supply, `Totem max_supply should be ${expectedTotem.max_supply}`);
-            assert.deepEqual(result.results[0].totem.allocations, expectedTotem.allocations, `Totem allocations should match`);
+            assert.deepEqual(result.results[0].meta.allocations, expectedMeta.allocations, `Totem allocations should match`);
             assert.deepEqual(result.results[0].totem.mods, expectedTotem.mods, `Totem mods should match`);
-            assert.deepEqual(result.results[0].totem.details, expectedTotem.details, `Totem details should match`);
+            assert.deepEqual(result.results[0].meta.details, expectedMeta.details, `Totem details should match`);
         }
     })
 
@@ -156,59 +157,62 @@ describe('Readonly Actions', () => {
         assert.equal(result.results.length, Object.keys(totems).length, `Should return all totems`);
         assert(result.results.every(({totem}) => Object.keys(totems).includes(totem.max_supply.split(' ')[1])), 'All returned totems should be in the original totems');
         for(const bundle of result.results){
-            const {totem} = bundle;
-            const expectedTotem = totemsContract.tables.totems().getTableRows().find((t:any) => t.max_supply === totem.max_supply);
+            const {totem, meta} = bundle;
+            const expectedTotem = totemsContract.tables.totemcore().getTableRows().find((t:any) => t.max_supply === totem.max_supply);
+            const expectedMeta = totemsContract.tables.totemmeta().getTableRows().find((m:any) => m.ticker === meta.ticker);
             const parsedTicker = totem.max_supply.split(' ')[1];
             const decimals = parseInt(totem.max_supply.split('.')[1].split(' ')[0].length);
             assert.equal(parsedTicker, expectedTotem.max_supply.split(' ')[1], `Totem ticker should be ${expectedTotem.max_supply.split(' ')[1]}`);
             assert.equal(decimals, 4, `Totem decimals should be 4`);
             assert.equal(totem.creator, expectedTotem.creator, `Totem creator should be ${expectedTotem.creator}`);
             assert.equal(totem.max_supply, expectedTotem.max_supply, `Totem max_supply should be ${expectedTotem.max_supply}`);
-            assert.deepEqual(totem.allocations, expectedTotem.allocations, `Totem allocations should match`);
+            assert.deepEqual(meta.allocations, expectedMeta.allocations, `Totem allocations should match`);
             assert.deepEqual(totem.mods, expectedTotem.mods, `Totem mods should match`);
-            assert.deepEqual(totem.details, expectedTotem.details, `Totem details should match`);
+            assert.deepEqual(meta.details, expectedMeta.details, `Totem details should match`);
         }
     });
 
     it('should be able to list totems', async () => {
-        const firstBatch = await totemsContract.actions.listtotems([5, null]).send().then(x => {
+        const firstBatch = await totemsContract.actions.listtotems([5, null, 0]).send().then(x => {
             return JSON.parse(JSON.stringify(x[0].returnValue));
         });
         assert.equal(firstBatch.results.length, 5, `Should return 5 totems`);
         assert(firstBatch.results.every(({totem}) => Object.keys(totems).includes(totem.max_supply.split(' ')[1])), 'All returned totems should be in the original totems');
         for(const bundle of firstBatch.results){
-            const {totem} = bundle;
-            const expectedTotem = totemsContract.tables.totems().getTableRows().find((t:any) => t.max_supply === totem.max_supply);
+            const {totem, meta} = bundle;
+            const expectedTotem = totemsContract.tables.totemcore().getTableRows().find((t:any) => t.max_supply === totem.max_supply);
+            const expectedMeta = totemsContract.tables.totemmeta().getTableRows().find((m:any) => m.ticker === meta.ticker);
             const parsedTicker = totem.max_supply.split(' ')[1];
             const decimals = parseInt(totem.max_supply.split('.')[1].split(' ')[0].length);
             assert.equal(parsedTicker, expectedTotem.max_supply.split(' ')[1], `Totem ticker should be ${expectedTotem.max_supply.split(' ')[1]}`);
             assert.equal(decimals, 4, `Totem decimals should be 4`);
             assert.equal(totem.creator, expectedTotem.creator, `Totem creator should be ${expectedTotem.creator}`);
             assert.equal(totem.max_supply, expectedTotem.max_supply, `Totem max_supply should be ${expectedTotem.max_supply}`);
-            assert.deepEqual(totem.allocations, expectedTotem.allocations, `Totem allocations should match`);
+            assert.deepEqual(meta.allocations, expectedMeta.allocations, `Totem allocations should match`);
             assert.deepEqual(totem.mods, expectedTotem.mods, `Totem mods should match`);
-            assert.deepEqual(totem.details, expectedTotem.details, `Totem details should match`);
+            assert.deepEqual(meta.details, expectedMeta.details, `Totem details should match`);
         }
 
-        const secondBatch = await totemsContract.actions.listtotems([5, firstBatch.cursor]).send().then(x => {
+        const secondBatch = await totemsContract.actions.listtotems([5, firstBatch.cursor, 0]).send().then(x => {
             return JSON.parse(JSON.stringify(x[0].returnValue));
         });
 
         assert.equal(secondBatch.results.length, 5, `Should return 5 totems`);
         assert(secondBatch.results.every(({totem}) => Object.keys(totems).includes(totem.max_supply.split(' ')[1])), 'All returned totems should be in the original totems');
         for(const bundle of secondBatch.results){
-            const {totem} = bundle;
+            const {totem, meta} = bundle;
             assert.isFalse(firstBatch.results.some(({totem:t}) => t.max_supply === totem.max_supply), `Totem ${totem.max_supply} should not be in the first batch`);
-            const expectedTotem = totemsContract.tables.totems().getTableRows().find((t:any) => t.max_supply === totem.max_supply);
+            const expectedTotem = totemsContract.tables.totemcore().getTableRows().find((t:any) => t.max_supply === totem.max_supply);
+            const expectedMeta = totemsContract.tables.totemmeta().getTableRows().find((m:any) => m.ticker === meta.ticker);
             const parsedTicker = totem.max_supply.split(' ')[1];
             const decimals = parseInt(totem.max_supply.split('.')[1].split(' ')[0].length);
             assert.equal(parsedTicker, expectedTotem.max_supply.split(' ')[1], `Totem ticker should be ${expectedTotem.max_supply.split(' ')[1]}`);
             assert.equal(decimals, 4, `Totem decimals should be 4`);
             assert.equal(totem.creator, expectedTotem.creator, `Totem creator should be ${expectedTotem.creator}`);
             assert.equal(totem.max_supply, expectedTotem.max_supply, `Totem max_supply should be ${expectedTotem.max_supply}`);
-            assert.deepEqual(totem.allocations, expectedTotem.allocations, `Totem allocations should match`);
+            assert.deepEqual(meta.allocations, expectedMeta.allocations, `Totem allocations should match`);
             assert.deepEqual(totem.mods, expectedTotem.mods, `Totem mods should match`);
-            assert.deepEqual(totem.details, expectedTotem.details, `Totem details should match`);
+            assert.deepEqual(meta.details, expectedMeta.details, `Totem details should match`);
         }
     });
 
@@ -221,7 +225,7 @@ describe('Readonly Actions', () => {
 
         const firstBatchTickers = Object.keys(totems).slice(0, 5);
         for(const account of ['holder.a', 'holder.b', 'holder.c']){
-            const result = await totemsContract.actions.getbalances([[account], firstBatchTickers]).send().then(x => {
+            const result = await totemsContract.actions.getbalances([[account], firstBatchTickers, 100, null, 0]).send().then(x => {
                 return JSON.parse(JSON.stringify(x[0].returnValue));
             });
 
@@ -236,7 +240,7 @@ describe('Readonly Actions', () => {
 
         const secondBatchTickers = Object.keys(totems).slice(5);
         for(const account of ['holder.a', 'holder.b', 'holder.c']){
-            const result = await totemsContract.actions.getbalances([[account], secondBatchTickers]).send().then(x => {
+            const result = await totemsContract.actions.getbalances([[account], secondBatchTickers, 100, null, 0]).send().then(x => {
                 return JSON.parse(JSON.stringify(x[0].returnValue));
             });
 
@@ -249,7 +253,7 @@ describe('Readonly Actions', () => {
             }
         }
 
-        const allBalances = await totemsContract.actions.getbalances([['holder.a'], []]).send().then(x => {
+        const allBalances = await totemsContract.actions.getbalances([['holder.a'], [], 100, null, 0]).send().then(x => {
             return JSON.parse(JSON.stringify(x[0].returnValue));
         });
         assert.equal(allBalances.balances.length, Object.keys(totems).length, `Should return balances for all totems for holder.a`);
@@ -262,7 +266,7 @@ describe('Readonly Actions', () => {
     it('should be able to get multiple balances for multiple accounts', async () => {
         const tickers = Object.keys(totems).slice(0,3);
         const accounts = ['holder.a', 'holder.b', 'holder.c'];
-        const result = await totemsContract.actions.getbalances([accounts, tickers]).send().then(x => {
+        const result = await totemsContract.actions.getbalances([accounts, tickers, 100, null, 0]).send().then(x => {
             return JSON.parse(JSON.stringify(x[0].returnValue));
         });
 
@@ -276,4 +280,124 @@ describe('Readonly Actions', () => {
             }
         }
     })
+
+    it('should list mod and totem cards', async () => {
+        const modCards = await market.actions.listcards([20, null, 0]).send().then(x => {
+            return JSON.parse(JSON.stringify(x[0].returnValue));
+        });
+        assert.equal(modCards.cards.length, Object.keys(mods).length, `Should return a card for every mod`);
+        for(const card of modCards.cards){
+            const expectedMod = market.tables.mods().getTableRows().find((m:any) => m.contract === card.contract);
+            assert.equal(card.seller, expectedMod.seller, `Card seller should be ${expectedMod.seller}`);
+            assert.equal(card.price, expectedMod.price, `Card price should be ${expectedMod.price}`);
+            assert.deepEqual(card.hooks, expectedMod.hooks, `Card hooks should match`);
+            assert.equal(card.title, expectedMod.details.name, `Card title should be ${expectedMod.details.name}`);
+            assert.isUndefined(card.required_actions, `Card should not include required actions`);
+        }
+
+        const totemCards = await totemsContract.actions.totemcards([Object.keys(totems)]).send().then(x => {
+            return JSON.parse(JSON.stringify(x[0].returnValue));
+        });
+        assert.equal(totemCards.cards.length, Object.keys(totems).length, `Should return a card for every totem`);
+        for(const card of totemCards.cards){
+            const expectedTotem = totemsContract.tables.totemcore().getTableRows().find((t:any) => t.max_supply === card.max_supply);
+            const expectedMeta = totemsContract.tables.totemmeta().getTableRows().find((m:any) => m.ticker === card.ticker);
+            assert.equal(card.supply, expectedTotem.supply, `Card supply should be ${expectedTotem.supply}`);
+            assert.equal(card.creator, expectedTotem.creator, `Card creator should be ${expectedTotem.creator}`);
+            assert.equal(card.title, expectedMeta.details.name, `Card title should be ${expectedMeta.details.name}`);
+            assert.equal(card.image, expectedMeta.details.image, `Card image should be ${expectedMeta.details.image}`);
+        }
+
+        const listed = await totemsContract.actions.listcards([5, null, 0]).send().then(x => {
+            return JSON.parse(JSON.stringify(x[0].returnValue));
+        });
+        assert.equal(listed.cards.length, 5, `Should return 5 cards`);
+        assert.isTrue(listed.has_more, `Should have more cards`);
+    })
+
+    it('should query mods and totems', async () => {
+        const maxPrice = 500;
+        const cheapMods = market.tables.mods().getTableRows().filter((m:any) => m.price <= maxPrice).map((m:any) => m.contract);
+
+        const found = [];
+        let cursor = null;
+        let has_more = true;
+        while(has_more){
+            // scanning 3 rows at a time means some pages have no matches, but they still move the cursor
+            const page = await market.actions.querymods([{ seller: 'seller', hook: 'transfer', is_minter: false, min_price: null, max_price: maxPrice }, 20, cursor, 3, 0]).send().then(x => {
+                return JSON.parse(JSON.stringify(x[0].returnValue));
+            });
+            found.push(...page.cards.map((c:any) => c.contract));
+            cursor = page.cursor;
+            has_more = page.has_more;
+        }
+        assert.deepEqual(found.sort(), cheapMods.sort(), `Should find every mod under ${maxPrice}`);
+
+        const mod = Object.keys(mods)[0];
+        const usingMod = totemsContract.tables.totemcore().getTableRows().filter((t:any) => t.mods.transfer.includes(mod));
+        const result = await totemsContract.actions.querytotems([{ creator: 'creator', uses_mod: mod, hook: 'transfer', min_holders: 1, min_transfers: 0, min_mints: 0 }, 20, null, 0, 0]).send().then(x => {
+            return JSON.parse(JSON.stringify(x[0].returnValue));
+        });
+        assert.equal(result.cards.length, usingMod.length, `Should find every totem using ${mod}`);
+        assert.isFalse(result.has_more, `Should have scanned every totem of the creator`);
+
+        const none = await totemsContract.actions.querytotems([{ creator: null, uses_mod: mod, hook: 'burn', min_holders: 0, min_transfers: 0, min_mints: 0 }, 20, null, 0, 0]).send().then(x => {
+            return JSON.parse(JSON.stringify(x[0].returnValue));
+        });
+        assert.equal(none.cards.length, 0, `No totem uses ${mod} on burn`);
+    })
+
+    it('should page balances with a byte budget and cursors', async () => {
+        const tickers = Object.keys(totems).slice(0,3);
+        const accounts = ['holder.c', 'holder.a', 'holder.b'];
+
+        const pages = [];
+        let cursor = null;
+        let has_more = true;
+        while(has_more){
+            const result = await totemsContract.actions.getbalances([accounts, tickers, 100, cursor, 1]).send().then(x => {
+                return JSON.parse(JSON.stringify(x[0].returnValue));
+            });
+            // the first row always fits, so a tiny budget gives one balance per page
+            assert.equal(result.balances.length, 1, `Each page should have one balance`);
+            pages.push(result.balances[0]);
+            cursor = result.cursor;
+            has_more = result.has_more;
+        }
+
+        assert.equal(pages.length, accounts.length * tickers.length, `Should page through every balance`);
+        const keys = pages.map((b:any) => `${b.account}:${b.balance.split(' ')[1]}`);
+        assert.equal(new Set(keys).size, keys.length, `Pages should not repeat balances`);
+
+        // a full page has more, the last (short) page doesn't
+        const firstPage = await totemsContract.actions.getbalances([accounts, tickers, 4, null, 0]).send().then(x => {
+            return JSON.parse(JSON.stringify(x[0].returnValue));
+        });
+        assert.equal(firstPage.balances.length, 4, `Should return one page of balances`);
+        assert.isTrue(firstPage.has_more, `A full page should have more`);
+        const lastPage = await totemsContract.actions.getbalances([accounts, tickers, 100, firstPage.cursor, 0]).send().then(x => {
+            return JSON.parse(JSON.stringify(x[0].returnValue));
+        });
+        assert.equal(lastPage.balances.length, accounts.length * tickers.length - 4, `Should return the rest of the balances`);
+        assert.isFalse(lastPage.has_more, `The last page should not have more`);
+        assert.deepEqual(pages.map((b:any) => b.account), [...pages.map((b:any) => b.account)].sort(), `Balances should be ordered by account`);
+    })
+
+    it('should end listing pages early when the byte budget is used', async () => {
+        const full = await totemsContract.actions.listtotems([5, null, 0]).send().then(x => {
+            return JSON.parse(JSON.stringify(x[0].returnValue));
+        });
+        const budgeted = await totemsContract.actions.listtotems([5, null, 1]).send().then(x => {
+            return JSON.parse(JSON.stringify(x[0].returnValue));
+        });
+
+        assert.equal(budgeted.results.length, 1, `Should only return the first totem`);
+        assert.isTrue(budgeted.has_more, `Should have more totems`);
+        assert.deepEqual(budgeted.results[0], full.results[0], `Should return the same first totem`);
+
+        const next = await totemsContract.actions.listtotems([5, budgeted.cursor, 0]).send().then(x => {
+            return JSON.parse(JSON.stringify(x[0].returnValue));
+        });
+        assert.deepEqual(next.results[0], full.results[1], `Cursor should continue from the next totem`);
+    })
 });
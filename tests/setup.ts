@@ -0,0 +1,7 @@
+import { $ } from "bun";
+
+// The specs load their contracts from build/, so they are rebuilt from the sources before every run.
+// Set SKIP_BUILD=1 to run against the artifacts that are already in build/.
+if (!process.env.SKIP_BUILD) {
+    await $`bun scripts/build.ts`;
+}
@@ -1,5 +1,5 @@
 import {Blockchain, nameToBigInt, expectToThrow, symbolCodeToBigInt} from "@vaulta/vert";
-import {Asset, Checksum256} from "@wharfkit/antelope";
+import {Asset, Bytes, Checksum256, Name, Serializer, UInt32} from "@wharfkit/antelope";
 // @ts-ignore
 import chai, { assert } from "chai";
 import {FieldType, serializeActionFields, uint8ToHex} from "../tools/serializer";
@@ -22,7 +22,7 @@ const freezer2 = blockchain.createContract('freezer2', 'build/freezer',  true);
 const burner = blockchain.createContract('burner', 'build/burner',  true);
 const testmod = blockchain.createContract('testmod', 'build/testmod',  true);
 const restricted = blockchain.createContract('restricted', 'build/testmod',  true);
-const ACCOUNTS = ['tester', 'eosio.fees', 'referrer', 'creator', 'holder', 'minter', 'seller', 'no.mod'];
+const ACCOUNTS = ['tester', 'eosio.fees', 'referrer', 'creator', 'holder', 'minter', 'seller', 'no.mod', 'rulemod'];
 blockchain.createAccounts(...ACCOUNTS)
 
 const totemMods = (obj:any = {}) => Object.assign({
@@ -173,22 +173,37 @@ describe('Totems', () => {
         ], undefined, 'creator');
 
 
+        // fees are credited in the ledger, not paid out inline
+        const ledger = JSON.parse(JSON.stringify(await contract.tables.feeledger(nameToBigInt(contract.name.toString())).getTableRows()));
+        assert(ledger.length === 1, "Fee ledger should have one recipient");
+        assert(ledger[0].recipient === 'eosio.fees', "Fee ledger should credit eosio.fees");
+        assert(ledger[0].amount === 100_0000, "Fee ledger should credit the full fee");
+        assert(getBalance('eosio.fees', eos) === 0, "Fee account should not be paid until swept");
+        assert(getBalance(contract.name.toString(), vaulta) === 100, "Contract should hold the owed fee");
+
+        await expectToThrow(contract.actions.claim(['creator']).send('creator'), 'eosio_assert: No fees to claim');
+        await contract.actions.sweepfees([10]).send('tester');
+        await expectToThrow(contract.actions.sweepfees([10]).send('tester'), 'eosio_assert: No fees to sweep');
+
         assert(getBalance('eosio.fees', eos) === 100, "Fee account should receive EOS fee");
         assert(getBalance('creator', vaulta) === 0, "Creator should not receive Vaulta fee");
         assert(getBalance(contract.name.toString(), vaulta) === 0, "Contract should not keep Vaulta fee");
 
-        const totems = JSON.parse(JSON.stringify(await contract.tables.totems(nameToBigInt(contract.name.toString())).getTableRows()));
+        const totems = JSON.parse(JSON.stringify(await contract.tables.totemcore(nameToBigInt(contract.name.toString())).getTableRows()));
         // console.log(JSON.stringify(totems, null, 4));
 
         assert(totems.length === 1, "Totem should be created");
         assert(totems[0].supply === '2000.0000 TEST', "Totem should have correct supply");
         assert(totems[0].max_supply === '2000.0000 TEST', "Totem should have correct max supply");
         assert(modsLength(totems[0]) === 0, "Totem should have no mods");
-        assert(totems[0].allocations.length === 2, "Totem should have 2 allocations");
-        assert(totems[0].allocations[0].recipient === 'minter', "Totem should have minter allocation");
-        assert(totems[0].allocations[0].quantity === '1000.0000 TEST', "Totem should have correct minter allocation");
-        assert(totems[0].allocations[1].recipient === 'creator', "Totem should have creator allocation");
-        assert(totems[0].allocations[1].quantity === '1000.0000 TEST', "Totem should have correct creator allocation");
+
+        const metas = JSON.parse(JSON.stringify(await contract.tables.totemmeta(nameToBigInt(contract.name.toString())).getTableRows()));
+        assert(metas.length === 1, "Totem meta should be created");
+        assert(metas[0].allocations.length === 2, "Totem should have 2 allocations");
+        assert(metas[0].allocations[0].recipient === 'minter', "Totem should have minter allocation");
+        assert(metas[0].allocations[0].quantity === '1000.0000 TEST', "Totem should have correct minter allocation");
+        assert(metas[0].allocations[1].recipient === 'creator', "Totem should have creator allocation");
+        assert(metas[0].allocations[1].quantity === '1000.0000 TEST', "Totem should have correct creator allocation");
         assert(totems[0].creator === 'creator', "Totem should have correct creator");
     });
 
@@ -229,7 +244,7 @@ describe('Totems', () => {
         await transfer('tester', 'creator', '100.0000 A');
         await transfer('creator', market.name.toString(), '100.0000 A');
 
-        await publish('seller', freezer.name.toString(), ['transfer'], 100_0000, {
+        await publish('seller', freezer.name.toString(), ['transfer', 'transfermany'], 100_0000, {
             name: "Cool Mod",
             summary: "This is a cool mod.",
             markdown: "## Cool Mod\n\nThis mod is really cool because...",
@@ -300,7 +315,7 @@ describe('Totems', () => {
             transfer: [freezer.name.toString()]
         }));
 
-        const totems = JSON.parse(JSON.stringify(await contract.tables.totems(nameToBigInt(contract.name.toString())).getTableRows()));
+        const totems = JSON.parse(JSON.stringify(await contract.tables.totemcore(nameToBigInt(contract.name.toString())).getTableRows()));
         // console.log(JSON.stringify(totems, null, 4));
         assert(totems.length === 2, "Totem should be created");
         assert(totems[1].supply === '500.0000 MODTEST', "Totem should have correct supply");
@@ -326,7 +341,7 @@ describe('Totems', () => {
         assert(getTotemBalance('tester', 'MODTEST') === 30, "Tester should have 30 MODTEST after burn");
 
         // supply should have decreased
-        const totems = JSON.parse(JSON.stringify(await contract.tables.totems(nameToBigInt(contract.name.toString())).getTableRows()));
+        const totems = JSON.parse(JSON.stringify(await contract.tables.totemcore(nameToBigInt(contract.name.toString())).getTableRows()));
         assert(totems[1].supply === '480.0000 MODTEST', "Totem should have correct supply after burn");
         assert(totems[1].max_supply === '500.0000 MODTEST', "Totem should have correct max supply after burn");
     });
@@ -338,6 +353,7 @@ describe('Totems', () => {
         await transfer('seller', market.name.toString(), '100.0000 A');
         await publish('seller', testmod.name.toString(), [
             'transfer',
+            'transfermany',
             'mint',
             'burn',
             'open',
@@ -408,7 +424,22 @@ describe('Totems', () => {
         }
         // Mint
         {
+            const minters = JSON.parse(JSON.stringify(await contract.tables.minters(symbolCodeToBigInt(SymbolCode.from('MODDED'))).getTableRows()));
+            assert.deepEqual(minters.map(m => m.mod), [testmod.name.toString()], "Only the minter allocation should be registered as a minter");
+            await expectToThrow(contract.actions.mint([freezer.name.toString(), 'creator', '10.0000 MODDED', '0.0000 EOS', '']).send('creator'), 'eosio_assert: Mod not authorized to mint for this totem');
+
+            await expectToThrow(contract.actions.mintpay([testmod.name.toString(), 'creator', '10.0000 MODDED']).send(testmod.name.toString()), 'eosio_assert: No mint to pay out');
+
+            const creatorBalance = getTotemBalance('creator', 'MODDED');
+            const modBalance = getTotemBalance(testmod.name.toString(), 'MODDED');
             await contract.actions.mint([testmod.name.toString(), 'creator', '10.0000 MODDED', '1.0000 EOS', '']).send('creator');
+            assert(getTotemBalance('creator', 'MODDED') === creatorBalance + 10, "Minter should be paid out by the mod");
+            assert(getTotemBalance(testmod.name.toString(), 'MODDED') === modBalance - 10, "Mod should pay out the mint");
+
+            // the ticket is used up by the payout, and never outlives its mint
+            const tickets = JSON.parse(JSON.stringify(await contract.tables.minttickets(symbolCodeToBigInt(SymbolCode.from('MODDED'))).getTableRows()));
+            assert(tickets.length === 0, "No mint ticket should be left after the mint");
+            await expectToThrow(contract.actions.mintpay([testmod.name.toString(), 'creator', '1.0000 MODDED']).send(testmod.name.toString()), 'eosio_assert: No mint to pay out');
             await toggleMod();
             await expectToThrow(contract.actions.mint([testmod.name.toString(), 'creator', '10.0000 MODDED', '1.0000 EOS', '']).send('creator'), 'eosio_assert: Mod is set to fail all actions');
             await toggleMod();
@@ -494,6 +525,14 @@ describe('Totems', () => {
         assert(newMod.price === 50_0000, "Mod price should match");
         assert(newMod.seller === 'seller', "Mod seller should match");
         assert(newMod.hooks.includes('burn'), "Mod should have burn hook");
+
+        const index = JSON.parse(JSON.stringify(await market.tables.modindex(nameToBigInt(market.name.toString())).getTableRows()));
+        const indexRow = index.find(m => m.contract === burner.name.toString());
+        assert(indexRow !== undefined, "Mod index row should exist");
+        assert(indexRow.price === 50_0000, "Mod index price should match");
+        assert(indexRow.seller === 'seller', "Mod index seller should match");
+        assert(indexRow.hooks === 1 << 2, "Mod index should only have the burn hook bit");
+        assert(indexRow.is_minter === true, "Mod index is_minter should match");
     });
 
     it('should verify RequiredHook formats and fields', async () => {
@@ -556,6 +595,34 @@ describe('Totems', () => {
         assert(action.fields[3].type === FieldType.TOTEM, "Fourth field should be TOTEM type");
     });
 
+    it('should compile hook plans for required actions on creation', async () => {
+        await transfer('tester', 'creator', '110.0000 A');
+        await transfer('creator', contract.name.toString(), '110.0000 A');
+
+        await create('4,PLAN', [
+            {
+                label: 'Test',
+                recipient: 'creator',
+                quantity: '1000.0000 PLAN'
+            }
+        ], totemMods({
+            transfer: ['tempmod']
+        }));
+
+        const plans = JSON.parse(JSON.stringify(await contract.tables.hookplans(symbolCodeToBigInt(SymbolCode.from('PLAN'))).getTableRows()));
+        assert(plans.length === 1, "There should only be a plan for the transfer hook");
+        assert(plans[0].hook === 'transfer', "Plan should be for the transfer hook");
+        assert(plans[0].actions.length === 1, "Plan should have 1 required action");
+        assert(plans[0].actions[0].contract === 'core.vaulta', "Plan action contract should match");
+        assert(plans[0].actions[0].action === 'transfer', "Plan action name should match");
+        assert(plans[0].actions[0].fields.length === 3, "DYNAMIC fields should not be compiled into the plan");
+
+        await expectToThrow(contract.actions.compileplans(['PLAN']).send('tester'), 'missing required authority creator');
+        await contract.actions.compileplans(['PLAN']).send('creator');
+        const recompiled = JSON.parse(JSON.stringify(await contract.tables.hookplans(symbolCodeToBigInt(SymbolCode.from('PLAN'))).getTableRows()));
+        assert(recompiled.length === 1 && recompiled[0].actions.length === 1, "Creator should be able to recompile the plans");
+    });
+
     it('should verify all Totem fields are stored properly', async () => {
         await transfer('tester', 'creator', '100.0000 A');
         await transfer('creator', contract.name.toString(), '100.0000 A');
@@ -590,36 +657,39 @@ describe('Totems', () => {
             burn: [burner.name.toString()]
         }), 'creator', totemDetails);
 
-        const totems = JSON.parse(JSON.stringify(await contract.tables.totems(nameToBigInt(contract.name.toString())).getTableRows()));
+        const totems = JSON.parse(JSON.stringify(await contract.tables.totemcore(nameToBigInt(contract.name.toString())).getTableRows()));
         const compTotem = totems.find(t => t.supply.includes('COMP'));
+        const metas = JSON.parse(JSON.stringify(await contract.tables.totemmeta(nameToBigInt(contract.name.toString())).getTableRows()));
+        const compMeta = metas.find(m => m.ticker === '4,COMP');
 
         assert(compTotem !== undefined, "COMP totem should exist");
+        assert(compMeta !== undefined, "COMP totem meta should exist");
 
         // Verify Totem basic fields
         assert(compTotem.creator === 'creator', "Creator should match");
         assert(compTotem.supply === '16000.0000 COMP', "Supply should match");
         assert(compTotem.max_supply === '16000.0000 COMP', "Max supply should match");
-        assert(compTotem.created_at !== undefined, "Created_at should be set");
+        assert(compMeta.created_at !== undefined, "Created_at should be set");
 
         // Verify TotemDetails
-        assert(compTotem.details.name === totemDetails.name, "Totem name should match");
-        assert(compTotem.details.description === totemDetails.description, "Totem description should match");
-        assert(compTotem.details.image === totemDetails.image, "Totem image should match");
-        assert(compTotem.details.website === totemDetails.website, "Totem website should match");
-        assert(compTotem.details.seed !== undefined, "Totem seed should be set");
+        assert(compMeta.details.name === totemDetails.name, "Totem name should match");
+        assert(compMeta.details.description === totemDetails.description, "Totem description should match");
+        assert(compMeta.details.image === totemDetails.image, "Totem image should match");
+        assert(compMeta.details.website === totemDetails.website, "Totem website should match");
+        assert(compMeta.details.seed !== undefined, "Totem seed should be set");
 
         // Verify MintAllocations
-        assert(compTotem.allocations.length === 3, "Should have 3 allocations");
-        assert(compTotem.allocations[0].label === 'Initial Distribution', "First allocation label should match");
-        assert(compTotem.allocations[0].recipient === 'holder', "First allocation recipient should match");
-        assert(compTotem.allocations[0].quantity === '5000.0000 COMP', "First allocation quantity should match");
-        assert(compTotem.allocations[1].label === 'Team Allocation', "Second allocation label should match");
-        assert(compTotem.allocations[1].recipient === 'creator', "Second allocation recipient should match");
-        assert(compTotem.allocations[1].quantity === '3000.0000 COMP', "Second allocation quantity should match");
-        assert(compTotem.allocations[2].label === 'Burner Mod', "Third allocation label should match");
-        assert(compTotem.allocations[2].recipient === burner.name.toString(), "Third allocation recipient should match");
-        assert(compTotem.allocations[2].quantity === '8000.0000 COMP', "Third allocation quantity should match");
-        assert(compTotem.allocations[2].is_minter === true, "Third allocation should be marked as minter");
+        assert(compMeta.allocations.length === 3, "Should have 3 allocations");
+        assert(compMeta.allocations[0].label === 'Initial Distribution', "First allocation label should match");
+        assert(compMeta.allocations[0].recipient === 'holder', "First allocation recipient should match");
+        assert(compMeta.allocations[0].quantity === '5000.0000 COMP', "First allocation quantity should match");
+        assert(compMeta.allocations[1].label === 'Team Allocation', "Second allocation label should match");
+        assert(compMeta.allocations[1].recipient === 'creator', "Second allocation recipient should match");
+        assert(compMeta.allocations[1].quantity === '3000.0000 COMP', "Second allocation quantity should match");
+        assert(compMeta.allocations[2].label === 'Burner Mod', "Third allocation label should match");
+        assert(compMeta.allocations[2].recipient === burner.name.toString(), "Third allocation recipient should match");
+        assert(compMeta.allocations[2].quantity === '8000.0000 COMP', "Third allocation quantity should match");
+        assert(compMeta.allocations[2].is_minter === true, "Third allocation should be marked as minter");
 
         // Verify TotemMods
         assert(compTotem.mods.transfer.length === 1, "Should have 1 transfer mod");
@@ -726,6 +796,137 @@ describe('Totems', () => {
         assert(getTotemBalance('tester', 'COMP') === initialTesterBalance + 100, "Tester balance should increase by 100");
     });
 
+    it('should be able to batch transfers', async () => {
+        const getStats = () => JSON.parse(JSON.stringify(contract.tables.totemstats(nameToBigInt(contract.name.toString())).getTableRows()))
+            .find(s => s.ticker === '4,COMP');
+
+        const holderBalance = getTotemBalance('holder', 'COMP');
+        const testerBalance = getTotemBalance('tester', 'COMP');
+        const creatorBalance = getTotemBalance('creator', 'COMP');
+        const stats = getStats();
+
+        await contract.actions.transfermany([[
+            { from: 'holder', to: 'tester', quantity: '10.0000 COMP', memo: '' },
+            { from: 'holder', to: 'creator', quantity: '5.0000 COMP', memo: '' },
+            { from: 'holder', to: 'tester', quantity: '1.0000 COMP', memo: '' },
+        ]]).send('holder');
+
+        assert(getTotemBalance('holder', 'COMP') === holderBalance - 16, "Holder balance should decrease by 16");
+        assert(getTotemBalance('tester', 'COMP') === testerBalance + 11, "Tester balance should increase by 11");
+        assert(getTotemBalance('creator', 'COMP') === creatorBalance + 5, "Creator balance should increase by 5");
+        assert(getStats().transfers === stats.transfers + 3, "Every leg should count as a transfer");
+        assert(getStats().holders === stats.holders, "Holders should not change");
+
+        await expectToThrow(contract.actions.transfermany([[
+            { from: 'holder', to: 'tester', quantity: '1.0000 COMP', memo: '' },
+            { from: 'tester', to: 'holder', quantity: '1.0000 COMP', memo: '' },
+        ]]).send('holder'), 'missing required authority tester');
+
+        await expectToThrow(contract.actions.transfermany([[
+            { from: 'holder', to: 'tester', quantity: `${holderBalance.toFixed(4)} COMP`, memo: '' },
+        ]]).send('holder'), 'eosio_assert: overdrawn balance of COMP');
+
+        // tempmod only handles single transfers
+        await expectToThrow(contract.actions.transfermany([[
+            { from: 'creator', to: 'tester', quantity: '1.0000 PLAN', memo: '' },
+        ]]).send('creator'), 'eosio_assert_message: Transfer mod does not support transfermany: tempmod');
+    });
+
+    it('should keep the holders of a totem in sync with balances', async () => {
+        const holders = JSON.parse(JSON.stringify(await contract.tables.holders(symbolCodeToBigInt(SymbolCode.from('COMP'))).getTableRows()));
+        for (const holder of ['holder', 'tester', 'creator']) {
+            const row = holders.find(h => h.owner === holder);
+            assert(row !== undefined, `${holder} should be a COMP holder`);
+            assert(row.amount / 10000 === getTotemBalance(holder, 'COMP'), `${holder} holder amount should match balance`);
+        }
+
+        const top = (await contract.actions.topholders(['COMP', 2]).send())[0].returnValue;
+        assert(top.length === 2, "Should return the top 2 holders");
+        assert(top[0].amount >= top[1].amount, "Top holders should be ordered by balance");
+        assert(top[0].amount === Math.max(...holders.map(h => h.amount)), "First top holder should have the largest balance");
+        await expectToThrow(contract.actions.topholders(['COMP', 101]).send(), 'eosio_assert: Too many top holders');
+
+        const firstPage = (await contract.actions.getholders(['COMP', null, 1, 0]).send())[0].returnValue;
+        assert(firstPage.holders.length === 1, "Should return one holder per page");
+        assert(firstPage.has_more === true, "Should have more holders");
+        const secondPage = (await contract.actions.getholders(['COMP', firstPage.cursor, 1, 0]).send())[0].returnValue;
+        assert(secondPage.holders[0].owner !== firstPage.holders[0].owner, "Cursor should move to the next holder");
+    });
+
+    it('should rank totems by their stats', async () => {
+        const stats = JSON.parse(JSON.stringify(await contract.tables.totemstats(nameToBigInt(contract.name.toString())).getTableRows()));
+
+        for (const metric of ['holders', 'transfers', 'mints']) {
+            const ranked = [];
+            let cursor = null;
+            let has_more = true;
+            while (has_more) {
+                const page = (await contract.actions.ranktotems([metric, 2, cursor, 0]).send())[0].returnValue;
+                ranked.push(...page.results);
+                cursor = page.cursor;
+                has_more = page.has_more;
+            }
+
+            assert(ranked.length === stats.length, `Should rank every totem by ${metric}`);
+            for (let i = 1; i < ranked.length; i++) {
+                assert(ranked[i - 1][metric] >= ranked[i][metric], `Totems should be ordered by ${metric}`);
+            }
+        }
+
+        await expectToThrow(contract.actions.ranktotems(['burns', 2, null, 0]).send(), 'eosio_assert: Unsupported metric: burns');
+    });
+
+    it('should track which totems use a mod', async () => {
+        const totems = JSON.parse(JSON.stringify(await contract.tables.totemcore(nameToBigInt(contract.name.toString())).getTableRows()));
+        const usingFreezer = totems.filter(t => Object.values(t.mods).some((mods:any) => mods.includes(freezer.name.toString())));
+
+        const result = (await contract.actions.totemsbymod([freezer.name.toString(), null, 100, 0]).send())[0].returnValue;
+        assert(result.usages.length === usingFreezer.length, "Should list every totem using the freezer");
+        // the freezer is only ever used on transfer
+        assert(result.usages.every(u => u.hooks === 1 << 3), "Freezer should only be used on the transfer hook");
+
+        const counts = JSON.parse(JSON.stringify(await contract.tables.modcounts(nameToBigInt(contract.name.toString())).getTableRows()));
+        assert(counts.find(c => c.mod === freezer.name.toString()).totems === usingFreezer.length, "Freezer usage count should match");
+
+        const ranked = (await market.actions.rankmods([100, null, 0]).send())[0].returnValue;
+        for (let i = 1; i < ranked.cards.length; i++) {
+            assert(ranked.cards[i - 1].totems >= ranked.cards[i].totems, "Mods should be ranked by usage");
+        }
+        assert(ranked.cards.find(c => c.card.contract === freezer.name.toString()).totems === usingFreezer.length, "Ranked freezer usage should match");
+    });
+
+    it('should list totems by creator and by creation time', async () => {
+        const totems = JSON.parse(JSON.stringify(await contract.tables.totemcore(nameToBigInt(contract.name.toString())).getTableRows()));
+        const metas = JSON.parse(JSON.stringify(await contract.tables.totemmeta(nameToBigInt(contract.name.toString())).getTableRows()));
+
+        const byCreator = [];
+        let cursor = null;
+        let has_more = true;
+        while (has_more) {
+            const page = (await contract.actions.listcreator(['creator', 2, cursor, 0]).send())[0].returnValue;
+            byCreator.push(...page.results);
+            cursor = page.cursor;
+            has_more = page.has_more;
+        }
+        const created = totems.filter(t => t.creator === 'creator');
+        assert(byCreator.length === created.length, "Should list every totem of the creator");
+        assert(byCreator.every(r => r.totem.creator === 'creator'), "Should only list totems of the creator");
+
+        const recent = [];
+        cursor = null;
+        has_more = true;
+        while (has_more) {
+            const page = (await contract.actions.listrecent([2, cursor, 0]).send())[0].returnValue;
+            recent.push(...page.results);
+            cursor = page.cursor;
+            has_more = page.has_more;
+        }
+        assert(recent.length === metas.length, "Should list every totem");
+        for (let i = 1; i < recent.length; i++) {
+            assert(new Date(recent[i - 1].meta.created_at) >= new Date(recent[i].meta.created_at), "Totems should be newest first");
+        }
+    });
+
     it('should verify all TotemMods array types', async () => {
         await transfer('tester', 'creator', '300.0000 A');
         await transfer('creator', contract.name.toString(), '300.0000 A');
@@ -746,7 +947,7 @@ describe('Totems', () => {
             created: [testmod.name.toString()]
         }));
 
-        const totems = JSON.parse(JSON.stringify(await contract.tables.totems(nameToBigInt(contract.name.toString())).getTableRows()));
+        const totems = JSON.parse(JSON.stringify(await contract.tables.totemcore(nameToBigInt(contract.name.toString())).getTableRows()));
         const allModsTotem = totems.find(t => t.supply.includes('ALLMODS'));
 
         assert(allModsTotem !== undefined, "ALLMODS totem should exist");
@@ -759,10 +960,395 @@ describe('Totems', () => {
         assert(modsLength(allModsTotem) === 6, "Should have 6 total mods");
     });
     it('should have licenses for all published mods', async () => {
-        const licenses = JSON.parse(JSON.stringify(await contract.tables.licenses(symbolCodeToBigInt(SymbolCode.from('ALLMODS'))).getTableRows()));
+        const getLicenses = () => JSON.parse(JSON.stringify(contract.tables.licenseset(nameToBigInt(contract.name.toString())).getTableRows()))
+            .find(l => l.ticker === 'ALLMODS').mods;
+
+        const licenses = getLicenses();
         assert(licenses.length === 2, "There should be 2 licenses for ALLMODS totem");
-        assert(!!licenses.find(l => l.mod === freezer.name.toString()), "Freezer license should exist");
-        assert(!!licenses.find(l => l.mod === testmod.name.toString()), "Testmod license should exist");
+        assert(licenses.includes(freezer.name.toString()), "Freezer license should exist");
+        assert(licenses.includes(testmod.name.toString()), "Testmod license should exist");
+        assert.deepEqual(licenses, [...licenses].sort(), "Licenses should be sorted");
+
+        const legacy = JSON.parse(JSON.stringify(await contract.tables.licenses(symbolCodeToBigInt(SymbolCode.from('ALLMODS'))).getTableRows()));
+        assert(legacy.length === 0, "Per-ticker license rows should not be written anymore");
+    });
+    it('should be able to add licenses to an existing totem', async () => {
+        await expectToThrow(market.actions.addlicenses(['ALLMODS', [burner.name.toString()]]).send('tester'), 'missing required authority creator');
+        await expectToThrow(contract.actions.addlicenses(['ALLMODS', [burner.name.toString()]]).send('creator'), `missing required authority ${market.name.toString()}`);
+
+        // the burner costs 50 A
+        await transfer('tester', 'creator', '50.0000 A');
+        await transfer('creator', market.name.toString(), '50.0000 A');
+        // listing the burner twice only charges for it once
+        await market.actions.addlicenses(['ALLMODS', [burner.name.toString(), freezer.name.toString(), burner.name.toString()]]).send('creator');
+
+        const licenses = JSON.parse(JSON.stringify(contract.tables.licenseset(nameToBigInt(contract.name.toString())).getTableRows()))
+            .find(l => l.ticker === 'ALLMODS').mods;
+        assert(licenses.length === 3, "Burner should be added and freezer should not be duplicated");
+        assert(licenses.includes(burner.name.toString()), "Burner license should exist");
+        assert.deepEqual(licenses, [...licenses].sort(), "Licenses should stay sorted");
+    });
+
+    it('should be able to create a totem in chunks', async () => {
+        const details = {
+            name: "A chunked totem",
+            image: "ipfs://QmTotemImageHash",
+            seed: Checksum256.hash('1110762033e7a10db4502359a19a61eb81312834769b8419047a2c9ae03ee847'),
+            description: "This totem has too many allocations for one action",
+            website: "https://totems.example.com",
+        };
+        const allocation = (recipient, quantity) => ({ label: 'Airdrop', recipient, quantity });
+
+        await transfer('tester', 'creator', '100.0000 A');
+        await transfer('creator', contract.name.toString(), '100.0000 A');
+        await contract.actions.reserve(['creator', '4,CHUNKED', totemMods(), details, null]).send('creator');
+        await expectToThrow(create('4,CHUNKED', [allocation('creator', '1.0000 CHUNKED')]), 'eosio_assert: A totem with this symbol already exists');
+
+        await expectToThrow(contract.actions.allocate(['CHUNKED', [allocation('tester', '1.0000 CHUNKED')]]).send('tester'), 'missing required authority creator');
+        await expectToThrow(
+            contract.actions.allocate(['CHUNKED', Array.from({ length: 101 }, () => allocation('tester', '1.0000 CHUNKED'))]).send('creator'),
+            'eosio_assert: Too many allocations in one batch'
+        );
+
+        await contract.actions.allocate(['CHUNKED', [allocation('tester', '5.0000 CHUNKED'), allocation('holder', '20.0000 CHUNKED')]]).send('creator');
+        // tester is allocated again, it's still one holder
+        await contract.actions.allocate(['CHUNKED', [allocation('creator', '30.0000 CHUNKED'), allocation('tester', '5.0000 CHUNKED')]]).send('creator');
+
+        const pending = JSON.parse(JSON.stringify(contract.tables.pendings(nameToBigInt(contract.name.toString())).getTableRows()));
+        assert(pending.length === 1, "Reserved totem should be pending");
+        assert(pending[0].supply === '60.0000 CHUNKED', "Pending supply should be the sum of the batches");
+        assert(pending[0].allocations === 4, "Pending totem should count its allocations");
+
+        let totems = JSON.parse(JSON.stringify(contract.tables.totemcore(nameToBigInt(contract.name.toString())).getTableRows()));
+        assert(!totems.find(t => t.max_supply.includes('CHUNKED')), "Totem should not exist before it is finalized");
+
+        await contract.actions.finalize(['CHUNKED']).send('creator');
+        await expectToThrow(contract.actions.finalize(['CHUNKED']).send('creator'), 'eosio_assert: Totem is not reserved');
+
+        totems = JSON.parse(JSON.stringify(contract.tables.totemcore(nameToBigInt(contract.name.toString())).getTableRows()));
+        const totem = totems.find(t => t.max_supply.includes('CHUNKED'));
+        assert(totem.supply === '60.0000 CHUNKED', "Totem should have the allocated supply");
+        assert(totem.max_supply === '60.0000 CHUNKED', "Totem should have the allocated max supply");
+
+        const stats = JSON.parse(JSON.stringify(contract.tables.totemstats(nameToBigInt(contract.name.toString())).getTableRows()))
+            .find(s => s.ticker === '4,CHUNKED');
+        assert(stats.holders === 3, "Recipients allocated twice should only be counted as one holder");
+        assert(stats.mints === 4, "Totem should have 4 mints");
+        assert(getTotemBalance('tester', 'CHUNKED') === 10, "Tester should have both allocations");
+        assert(getTotemBalance('holder', 'CHUNKED') === 20, "Holder should have 20 CHUNKED");
+        assert(JSON.parse(JSON.stringify(contract.tables.pendings(nameToBigInt(contract.name.toString())).getTableRows())).length === 0, "Pending row should be removed");
+
+        const meta = JSON.parse(JSON.stringify(contract.tables.totemmeta(nameToBigInt(contract.name.toString())).getTableRows()))
+            .find(m => m.ticker === '4,CHUNKED');
+        assert(meta.allocations.length === 0 && meta.allocation_count === 4, "Chunked totems should only record their number of allocations");
+
+        await contract.actions.transfer(['holder', 'tester', '5.0000 CHUNKED', '']).send('holder');
+    });
+
+    it('should be able to cancel a reserved totem', async () => {
+        const details = {
+            name: "A cancelled totem",
+            image: "ipfs://QmTotemImageHash",
+            seed: Checksum256.hash('1110762033e7a10db4502359a19a61eb81312834769b8419047a2c9ae03ee847'),
+            description: "This totem is given up before it is finalized",
+            website: "https://totems.example.com",
+        };
+        const getPendings = () => JSON.parse(JSON.stringify(contract.tables.pendings(nameToBigInt(contract.name.toString())).getTableRows()));
+
+        await transfer('tester', 'creator', '200.0000 A');
+        await transfer('creator', contract.name.toString(), '200.0000 A');
+        await contract.actions.reserve(['creator', '4,SQUAT', totemMods(), details, null]).send('creator');
+        await contract.actions.allocate(['SQUAT', [{ label: 'Airdrop', recipient: 'tester', quantity: '5.0000 SQUAT' }]]).send('creator');
+
+        await expectToThrow(contract.actions.cancel(['SQUAT']).send('tester'), 'missing required authority creator');
+        await contract.actions.cancel(['SQUAT']).send('creator');
+        assert(getPendings().length === 0, "Pending row should be removed");
+        assert(getTotemBalance('tester', 'SQUAT') === 0, "Allocated balances should be taken back");
+        const holders = JSON.parse(JSON.stringify(await contract.tables.holders(symbolCodeToBigInt(SymbolCode.from('SQUAT'))).getTableRows()));
+        assert(holders.length === 0, "Allocation recipients should no longer be holders");
+        await expectToThrow(contract.actions.cancel(['SQUAT']).send('creator'), 'eosio_assert: Totem is not reserved');
+
+        // the ticker is free again
+        await contract.actions.reserve(['creator', '4,SQUAT', totemMods(), details, null]).send('creator');
+        await contract.actions.cancel(['SQUAT']).send('creator');
+    });
+
+    it('should be able to claim lazy allocations from an allocation root', async () => {
+        const encode = (object) => Serializer.encode({object}).hexString;
+        const leaf = (index, account, quantity) =>
+            Checksum256.hash(Bytes.from(encode(UInt32.from(index)) + encode(Name.from(account)) + encode(Asset.from(quantity)), 'hex'));
+        const pair = (a, b) => Checksum256.hash(Bytes.from([a.hexString, b.hexString].sort().join(''), 'hex'));
+
+        const leaves = [
+            leaf(0, 'tester', '10.0000 DROP'),
+            leaf(1, 'holder', '20.0000 DROP'),
+            leaf(2, 'minter', '30.0000 DROP'),
+        ];
+        const root = pair(pair(leaves[0], leaves[1]), leaves[2]);
+        const proofs = [
+            [leaves[1], leaves[2]],
+            [leaves[0], leaves[2]],
+            [pair(leaves[0], leaves[1])],
+        ].map(proof => proof.map(p => p.hexString));
+
+        await transfer('tester', 'creator', '100.0000 A');
+        await transfer('creator', contract.name.toString(), '100.0000 A');
+        await contract.actions.create([
+            'creator',
+            '4,DROP',
+            [{ label: 'Creator', recipient: 'creator', quantity: '100.0000 DROP' }],
+            totemMods(),
+            {
+                name: "A dropped totem",
+                image: "ipfs://QmTotemImageHash",
+                seed: Checksum256.hash('1110762033e7a10db4502359a19a61eb81312834769b8419047a2c9ae03ee847'),
+                description: "Most of this totem is claimed lazily",
+                website: "https://totems.example.com",
+            },
+            null,
+            { root: root.hexString, total: '60.0000 DROP', leaves: 3 }
+        ]).send('creator');
+
+        const getTotem = () => JSON.parse(JSON.stringify(contract.tables.totemcore(nameToBigInt(contract.name.toString())).getTableRows()))
+            .find(t => t.max_supply.includes('DROP'));
+        assert(getTotem().supply === '100.0000 DROP', "Unclaimed allocations should not be in the supply");
+        assert(getTotem().max_supply === '160.0000 DROP', "Unclaimed allocations should be in the max supply");
+        assert(getTotemBalance('tester', 'DROP') === 0, "Tester should not have a balance before claiming");
+
+        await expectToThrow(contract.actions.claimalloc(['DROP', 0, 'tester', '10.0000 DROP', proofs[0]]).send('holder'), 'missing required authority tester');
+        await expectToThrow(contract.actions.claimalloc(['DROP', 0, 'tester', '11.0000 DROP', proofs[0]]).send('tester'), 'eosio_assert: Invalid allocation proof');
+        await expectToThrow(contract.actions.claimalloc(['DROP', 1, 'tester', '10.0000 DROP', proofs[0]]).send('tester'), 'eosio_assert: Invalid allocation proof');
+        await expectToThrow(contract.actions.claimalloc(['DROP', 3, 'tester', '10.0000 DROP', proofs[0]]).send('tester'), 'eosio_assert: Invalid allocation index');
+
+        await contract.actions.claimalloc(['DROP', 0, 'tester', '10.0000 DROP', proofs[0]]).send('tester');
+        await expectToThrow(contract.actions.claimalloc(['DROP', 0, 'tester', '10.0000 DROP', proofs[0]]).send('tester'), 'eosio_assert: Allocation already claimed');
+        await contract.actions.claimalloc(['DROP', 2, 'minter', '30.0000 DROP', proofs[2]]).send('minter');
+
+        assert(getTotemBalance('tester', 'DROP') === 10, "Tester should have claimed 10 DROP");
+        assert(getTotemBalance('minter', 'DROP') === 30, "Minter should have claimed 30 DROP");
+        assert(getTotem().supply === '140.0000 DROP', "Claims should be added to the supply");
+
+        const drop = JSON.parse(JSON.stringify(contract.tables.drops(nameToBigInt(contract.name.toString())).getTableRows()))
+            .find(d => d.ticker === '4,DROP');
+        assert(drop.claimed === '40.0000 DROP', "Drop should track the claimed quantity");
+        assert(drop.claims === 2, "Drop should track the number of claims");
+
+        const stats = JSON.parse(JSON.stringify(contract.tables.totemstats(nameToBigInt(contract.name.toString())).getTableRows()))
+            .find(s => s.ticker === '4,DROP');
+        assert(stats.holders === 3, "Claimers should be counted as holders");
+        assert(stats.mints === 3, "Claims should be counted as mints");
+
+        // claims follow the totem's policy like mints do
+        const policy = (frozen, max_holding_bps) => ({ frozen, max_holding_bps, paused_hooks: 0 });
+        await contract.actions.setpolicy(['DROP', policy(true, 0)]).send('creator');
+        await expectToThrow(contract.actions.claimalloc(['DROP', 1, 'holder', '20.0000 DROP', proofs[1]]).send('holder'), 'eosio_assert: Totem is frozen');
+        // 10% of the 160 DROP max supply
+        await contract.actions.setpolicy(['DROP', policy(false, 1000)]).send('creator');
+        await expectToThrow(
+            contract.actions.claimalloc(['DROP', 1, 'holder', '20.0000 DROP', proofs[1]]).send('holder'),
+            "eosio_assert: Cannot hold more than the totem's holding cap"
+        );
+        await contract.actions.setpolicy(['DROP', policy(false, 0)]).send('creator');
+        await contract.actions.claimalloc(['DROP', 1, 'holder', '20.0000 DROP', proofs[1]]).send('holder');
+    });
+
+    it('should enforce native totem policies', async () => {
+        const policy = (frozen, max_holding_bps, paused_hooks) => ({ frozen, max_holding_bps, paused_hooks });
+
+        await expectToThrow(contract.actions.setpolicy(['CHUNKED', policy(true, 0, 0)]).send('tester'), 'missing required authority creator');
+        await expectToThrow(contract.actions.setpolicy(['CHUNKED', policy(false, 10001, 0)]).send('creator'), 'eosio_assert: Holding cap can\'t be over 10000 basis points');
+
+        await contract.actions.setpolicy(['CHUNKED', policy(true, 0, 0)]).send('creator');
+        await expectToThrow(contract.actions.transfer(['tester', 'holder', '1.0000 CHUNKED', '']).send('tester'), 'eosio_assert: Totem is frozen');
+        await expectToThrow(contract.actions.burn(['tester', '1.0000 CHUNKED', '']).send('tester'), 'eosio_assert: Totem is frozen');
+        await expectToThrow(contract.actions.transfermany([[{ from: 'tester', to: 'holder', quantity: '1.0000 CHUNKED', memo: '' }]]).send('tester'), 'eosio_assert: Totem is frozen');
+
+        // pause transfers only
+        await contract.actions.setpolicy(['CHUNKED', policy(false, 0, 1 << 3)]).send('creator');
+        await expectToThrow(contract.actions.transfer(['tester', 'holder', '1.0000 CHUNKED', '']).send('tester'), 'eosio_assert_message: Totem transfer is paused');
+        await contract.actions.burn(['tester', '1.0000 CHUNKED', '']).send('tester');
+
+        // 50% of the 60 CHUNKED max supply
+        await contract.actions.setpolicy(['CHUNKED', policy(false, 5000, 0)]).send('creator');
+        const holderBalance = getTotemBalance('holder', 'CHUNKED');
+        await expectToThrow(
+            contract.actions.transfer(['creator', 'holder', `${(31 - holderBalance).toFixed(4)} CHUNKED`, '']).send('creator'),
+            "eosio_assert: Cannot hold more than the totem's holding cap"
+        );
+        await contract.actions.transfer(['creator', 'holder', `${(30 - holderBalance).toFixed(4)} CHUNKED`, '']).send('creator');
+        assert(getTotemBalance('holder', 'CHUNKED') === 30, "Holder should be able to hold up to the cap");
+
+        const totem = JSON.parse(JSON.stringify(contract.tables.totemcore(nameToBigInt(contract.name.toString())).getTableRows()))
+            .find(t => t.max_supply.includes('CHUNKED'));
+        assert(totem.policy.max_holding_bps === 5000, "Policy should be stored on the totem");
+
+        await contract.actions.setpolicy(['CHUNKED', policy(false, 0, 0)]).send('creator');
+    });
+
+    it('should run rule mods inline instead of notifying them', async () => {
+        const details = {
+            name: "Transfer cap",
+            summary: "Rejects transfers of more than 100 tokens.",
+            markdown: "",
+            website: "",
+            website_token_path: "",
+            image: "image",
+            is_minter: false,
+        };
+        const publishRule = (seller, rule) => market.actions.publish([seller, 'rulemod', ['transfer'], 0, details, [], null, rule]).send(seller);
+
+        // FIELD AMOUNT, PUSH 100.0000, LE
+        const rule = [0x02, 0x02, 0x01, 0x40, 0x42, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x23];
+
+        await transfer('tester', market.name.toString(), '100.0000 A');
+        await expectToThrow(publishRule('seller', rule), 'missing required authority rulemod');
+        await expectToThrow(publishRule('rulemod', [0x23]), 'eosio_assert: Rule stack underflow');
+        await expectToThrow(publishRule('rulemod', [0x02, 0x09]), 'eosio_assert: Unknown rule field');
+        await expectToThrow(publishRule('rulemod', [0x02, 0x02, 0x02, 0x02]), 'eosio_assert: Rule program must leave exactly one value');
+        await publishRule('rulemod', rule);
+
+        const index = JSON.parse(JSON.stringify(market.tables.modindex(nameToBigInt(market.name.toString())).getTableRows()))
+            .find(m => m.contract === 'rulemod');
+        assert(index.has_rule === true, "Mod index should mark rule mods");
+
+        await transfer('tester', 'creator', '100.0000 A');
+        await transfer('creator', contract.name.toString(), '100.0000 A');
+        await create('4,RULED', [
+            { label: 'Creator', recipient: 'creator', quantity: '1000.0000 RULED' }
+        ], totemMods({ transfer: ['rulemod'] }));
+
+        const plans = JSON.parse(JSON.stringify(contract.tables.hookplans(symbolCodeToBigInt(SymbolCode.from('RULED'))).getTableRows()));
+        assert(plans.length === 1, "Only the transfer hook should have a plan");
+        assert(plans[0].actions.length === 0, "Rule mods should not add required actions");
+        assert(plans[0].rules[0].mod === 'rulemod', "The rule should be compiled into the plan");
+
+        await contract.actions.transfer(['creator', 'tester', '100.0000 RULED', '']).send('creator');
+        await expectToThrow(
+            contract.actions.transfer(['creator', 'tester', '100.0001 RULED', '']).send('creator'),
+            'eosio_assert_message: Rejected by rule mod: rulemod'
+        );
+        await expectToThrow(
+            contract.actions.transfermany([[
+                { from: 'creator', to: 'tester', quantity: '1.0000 RULED', memo: '' },
+                { from: 'creator', to: 'holder', quantity: '101.0000 RULED', memo: '' },
+            ]]).send('creator'),
+            'eosio_assert_message: Rejected by rule mod: rulemod'
+        );
+        assert(getTotemBalance('tester', 'RULED') === 100, "Tester should only have the accepted transfer");
+    });
+
+    it('should only notify subscribed mods of matching operations', async () => {
+        const mod = testmod.name.toString();
+        const filter = (accounts, direction, min_amount = 0, memo_prefix = '', async = false) => ({ mod, accounts, direction, min_amount, memo_prefix, async });
+        const subscribe = (ticker, hook, f, authorizer = mod) => contract.actions.subscribe([ticker, hook, f]).send(authorizer);
+
+        await expectToThrow(subscribe('MODDED', 'transfer', filter(['holder'], 2), 'tester'), `missing required authority ${mod}`);
+        await expectToThrow(subscribe('CHUNKED', 'transfer', filter(['holder'], 2)), 'eosio_assert: Mod is not used by this totem on this hook');
+        await expectToThrow(subscribe('MODDED', 'transfer', filter(['holder'], 3)), 'eosio_assert: Invalid filter direction');
+
+        // only transfers to the holder
+        await subscribe('MODDED', 'transfer', filter(['holder'], 2));
+        const subs = JSON.parse(JSON.stringify(contract.tables.hooksubs(symbolCodeToBigInt(SymbolCode.from('MODDED'))).getTableRows()));
+        assert(subs.length === 1 && subs[0].filters.length === 1, "There should be one transfer filter");
+
+        // the mod fails everything it is notified of
+        await testmod.actions.toggle().send('tester');
+        await contract.actions.transfer(['tester', 'creator', '1.0000 MODDED', '']).send('tester');
+        await expectToThrow(contract.actions.transfer(['tester', 'holder', '1.0000 MODDED', '']).send('tester'), 'eosio_assert: Mod is set to fail all actions');
+        await expectToThrow(
+            contract.actions.transfermany([[
+                { from: 'tester', to: 'creator', quantity: '1.0000 MODDED', memo: '' },
+                { from: 'tester', to: 'holder', quantity: '1.0000 MODDED', memo: '' },
+            ]]).send('tester'),
+            'eosio_assert: Mod is set to fail all actions'
+        );
+
+        // replacing the filter, only transfers of at least 10 with a "watch" memo
+        await subscribe('MODDED', 'transfer', filter([], 0, 10_0000, 'watch'));
+        await contract.actions.transfer(['tester', 'holder', '1.0000 MODDED', 'watch']).send('tester');
+        await contract.actions.transfer(['tester', 'holder', '10.0000 MODDED', 'other']).send('tester');
+        await expectToThrow(contract.actions.transfer(['tester', 'holder', '10.0000 MODDED', 'watch me']).send('tester'), 'eosio_assert: Mod is set to fail all actions');
+
+        await contract.actions.unsubscribe([mod, 'MODDED', 'transfer']).send(mod);
+        await expectToThrow(contract.actions.unsubscribe([mod, 'MODDED', 'transfer']).send(mod), 'eosio_assert: Mod is not subscribed');
+        await expectToThrow(contract.actions.transfer(['tester', 'creator', '1.0000 MODDED', '']).send('tester'), 'eosio_assert: Mod is set to fail all actions');
+        await testmod.actions.toggle().send('tester');
+    });
+
+    it('should queue events for async mods and deliver them with crank', async () => {
+        const mod = testmod.name.toString();
+        const getQueue = () => JSON.parse(JSON.stringify(contract.tables.hookqueue(nameToBigInt(mod)).getTableRows()));
+
+        await contract.actions.subscribe(['MODDED', 'transfer', { mod, accounts: [], direction: 0, min_amount: 0, memo_prefix: '', async: true }]).send(mod);
+
+        // a failing async mod is no longer part of the transfer
+        await testmod.actions.toggle().send('tester');
+        await contract.actions.transfer(['tester', 'creator', '1.0000 MODDED', 'poison' + 'x'.repeat(300)]).send('tester');
+        await contract.actions.transfermany([[
+            { from: 'tester', to: 'creator', quantity: '1.0000 MODDED', memo: 'first' },
+            { from: 'tester', to: 'holder', quantity: '2.0000 MODDED', memo: '' },
+        ]]).send('tester');
+
+        let queue = getQueue();
+        assert(queue.length === 3, "Every transfer leg should be queued");
+        assert(queue[0].hook === 'transfer' && queue[0].from === 'tester' && queue[0].to === 'creator', "Events should hold the operation");
+        assert(queue[0].memo === ('poison' + 'x'.repeat(300)).slice(0, 256) && queue[1].memo === 'first', "Events should hold the memo, cut to 256 bytes");
+        assert(queue[2].quantity === '2.0000 MODDED', "Events should be queued in order");
+
+        // the mod only fails its own crank
+        await expectToThrow(contract.actions.crank([mod, 2]).send('tester'), 'eosio_assert: Mod is set to fail all actions');
+        await testmod.actions.toggle().send('tester');
+
+        // and can drop an event it can't process
+        await expectToThrow(contract.actions.skipevents([mod, 1]).send('tester'), `missing required authority ${mod}`);
+        await expectToThrow(contract.actions.skipevents([mod, 101]).send(mod), 'eosio_assert: Too many events to skip');
+        await contract.actions.skipevents([mod, 1]).send(mod);
+        queue = getQueue();
+        assert(queue.length === 2 && queue[0].memo === 'first', "Skipping should drop the oldest event");
+
+        await expectToThrow(contract.actions.crank([mod, 101]).send('tester'), 'eosio_assert: Too many events in one crank');
+        await contract.actions.crank([mod, 1]).send('tester');
+        queue = getQueue();
+        assert(queue.length === 1 && queue[0].to === 'holder', "Crank should deliver the oldest events first");
+        await contract.actions.crank([mod, 2]).send('holder');
+        assert(getQueue().length === 0, "Queue should be empty");
+        await expectToThrow(contract.actions.crank([mod, 2]).send('tester'), 'eosio_assert: No events to deliver');
+
+        await contract.actions.unsubscribe([mod, 'MODDED', 'transfer']).send(mod);
+    });
+
+    it('should journal events in sequence for indexers', async () => {
+        const tail = (await contract.actions.events([0, 1]).send())[0].returnValue;
+        assert(tail.events.length === 1 && Number(tail.events[0].seq) === 1, "Following from 0 should start at the oldest event");
+        assert(tail.has_more === true, "Earlier actions should all be journaled");
+        assert(Number(tail.oldest_seq) === 1 && tail.gap === false, "Nothing should have been overwritten yet");
+        await expectToThrow(contract.actions.events([0, 101]).send(), 'eosio_assert: Too many events in one page');
+
+        // skip to the end of the journal
+        let cursor = Number(tail.cursor);
+        let page = tail;
+        while (page.has_more) {
+            page = (await contract.actions.events([cursor, 100]).send())[0].returnValue;
+            cursor = Number(page.cursor);
+        }
+
+        await contract.actions.transfer(['tester', 'holder', '1.0000 MODDED', '']).send('tester');
+        await contract.actions.burn(['tester', '2.0000 MODDED', '']).send('tester');
+
+        const next = (await contract.actions.events([cursor, 100]).send())[0].returnValue;
+        assert(next.events.length === 2 && next.has_more === false, "Only the new events should be returned");
+        const [transfer, burn] = next.events;
+        assert(Number(transfer.seq) === cursor + 1 && Number(burn.seq) === cursor + 2, "Events should be sequenced");
+        assert(transfer.kind === 'transfer' && transfer.ticker === 'MODDED', "Transfer should be journaled for its totem");
+        assert(transfer.from === 'tester' && transfer.to === 'holder' && Number(transfer.amount) === 1_0000, "Transfer event should hold the operation");
+        assert(burn.kind === 'burn' && burn.from === 'tester' && Number(burn.amount) === 2_0000, "Burn event should hold the operation");
+        assert(Number(burn.ticker_seq) === Number(transfer.ticker_seq) + 1, "Events should also be sequenced per totem");
+        assert(Number(next.cursor) === cursor + 2, "Cursor should be the last returned seq");
+
+        const seqs = JSON.parse(JSON.stringify(await contract.tables.tickerseqs(nameToBigInt(contract.name.toString())).getTableRows()));
+        assert(seqs.find((row: any) => row.ticker === 'MODDED').last_seq == burn.ticker_seq, "Totem seq should be tracked");
 
+        const empty = (await contract.actions.events([Number(next.cursor), 100]).send())[0].returnValue;
+        assert(empty.events.length === 0 && Number(empty.cursor) === Number(next.cursor) && empty.has_more === false, "Nothing should be returned past the end");
     });
 });